@@ -1,6 +1,7 @@
 #include <regex>
 
 #include <clang/AST/ASTContext.h>
+#include <clang/AST/RecordLayout.h>
 #include <clang/Basic/Version.h>
 
 #include "astvisitor.h"
@@ -171,6 +172,7 @@ Class* SmokegenASTVisitor::registerClass(const clang::CXXRecordDecl* clangClass)
 
     if (!isForward && !clangClass->getTypeForDecl()->isDependentType()) {
         addQPropertyAnnotations(clangClass);
+        klass->setIsStandardLayout(clangClass->isStandardLayout());
 
         // Set base classes
         for (const clang::CXXBaseSpecifier& base : clangClass->bases()) {
@@ -181,10 +183,18 @@ Class* SmokegenASTVisitor::registerClass(const clang::CXXRecordDecl* clangClass)
                 continue;
             }
 
+            // the layout the compiler will use, so the generator can write constant offsets for casts
+            long long offset = -1;
+            if (!base.isVirtual() && !clangClass->isInvalidDecl() && baseRecordDecl->hasDefinition()) {
+                const clang::ASTRecordLayout& layout = ci.getASTContext().getASTRecordLayout(clangClass);
+                offset = layout.getBaseClassOffset(baseRecordDecl).getQuantity();
+            }
+
             Class::BaseClassSpecifier baseClass = Class::BaseClassSpecifier {
                 &classes[QString::fromStdString(baseRecordDecl->getQualifiedNameAsString())],
                 toAccess(base.getAccessSpecifier()),
-                base.isVirtual()
+                base.isVirtual(),
+                offset
             };
 
             klass->appendBaseClass(baseClass);
@@ -271,6 +281,11 @@ Class* SmokegenASTVisitor::registerClass(const clang::CXXRecordDecl* clangClass)
             );
             if (varDecl) {
                 field.setFlag(Member::Static);
+                // 'static const int x = 1;' needs no definition as long as its address isn't taken
+                if (varDecl->getInit() && !varDecl->isInline())
+                    field.setFlag(Member::InClassInitializer);
+            } else if (fieldDecl->isBitField()) {
+                field.setFlag(Member::BitField);
             }
             klass->appendField(field);
         }
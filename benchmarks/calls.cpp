@@ -0,0 +1,48 @@
+#include <smoke.h>
+
+#include <benchmark/benchmark.h>
+
+// The stack of a call with 4 arguments, as a binding builds it for classFn: with new and delete[] per call, or on
+// the C++ stack like the generated virtual overrides do
+
+namespace {
+
+const int NumArgs = 4;
+
+void classFn(Smoke::Index, void *, Smoke::Stack args) {
+    args[0].s_int = args[1].s_int + args[2].s_int + args[3].s_int + args[4].s_int;
+}
+
+// the call, once the stack is there
+inline void call(Smoke::ClassFn fn, Smoke::Stack stack) {
+    for (int i = 1; i <= NumArgs; ++i)
+        stack[i].s_int = i;
+    (*fn)(1, 0, stack);
+    benchmark::DoNotOptimize(stack[0].s_int);
+}
+
+}
+
+static void BM_CallNewStack(benchmark::State &state) {
+    Smoke::ClassFn fn = classFn;
+    benchmark::DoNotOptimize(fn);
+    for (auto _ : state) {
+        Smoke::Stack stack = new Smoke::StackItem[NumArgs + 1];
+        benchmark::DoNotOptimize(stack);
+        call(fn, stack);
+        delete[] stack;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CallNewStack)->Threads(1)->Threads(2)->Threads(4)->UseRealTime();
+
+static void BM_CallCStack(benchmark::State &state) {
+    Smoke::ClassFn fn = classFn;
+    benchmark::DoNotOptimize(fn);
+    for (auto _ : state) {
+        Smoke::StackItem stack[NumArgs + 1];
+        call(fn, stack);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CallCStack)->Threads(1)->Threads(2)->Threads(4)->UseRealTime();
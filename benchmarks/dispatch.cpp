@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+#include <typeinfo>
+#include <vector>
+
+// The test virtual x_ methods run before choosing between a direct and a virtual call, on classes shaped like
+// the generated ones: x_Widget derives from the wrapped class and from __internal_SmokeClass.
+
+namespace {
+
+class __internal_SmokeClass {};
+
+class Object {
+public:
+    virtual ~Object() {}
+    virtual int event() { return 1; }
+};
+
+class Paintable {
+public:
+    virtual ~Paintable() {}
+    virtual int paint() { return 2; }
+};
+
+class Widget : public Object, public Paintable {
+public:
+    int event() { return 3; }
+};
+
+// a class of the application, not created by the binding
+class Button : public Widget {
+public:
+    int event() { return 4; }
+};
+
+class x_Widget : public Widget, public __internal_SmokeClass {
+public:
+    bool x_createdByBinding() {
+        const std::type_info& xtype = typeid(*static_cast<Widget*>(this));
+        if (xtype == typeid(x_Widget))
+            return true;
+        if (xtype == typeid(Widget))
+            return false;
+        return dynamic_cast<__internal_SmokeClass*>(static_cast<Widget*>(this)) != 0;
+    }
+    bool x_dynamicCast() {
+        return dynamic_cast<__internal_SmokeClass*>(static_cast<Widget*>(this)) != 0;
+    }
+};
+
+class x_Button : public Button, public __internal_SmokeClass {};
+
+enum ObjectKind {
+    BindingObject,      // x_Widget
+    PlainObject,        // Widget
+    DerivedObject,      // Button
+    DerivedBindingObject    // x_Button, an x_ class of a subclass
+};
+
+std::vector<Widget*> makeObjects(int kind) {
+    std::vector<Widget*> objects;
+    for (int i = 0; i < 64; ++i) {
+        switch (kind) {
+        case BindingObject: objects.push_back(new x_Widget); break;
+        case PlainObject: objects.push_back(new Widget); break;
+        case DerivedObject: objects.push_back(new Button); break;
+        case DerivedBindingObject: objects.push_back(new x_Button); break;
+        }
+    }
+    return objects;
+}
+
+void deleteObjects(const std::vector<Widget*> &objects) {
+    for (Widget *object : objects)
+        delete object;
+}
+
+}
+
+// arg: the ObjectKind of the objects
+
+static void BM_DynamicCastCheck(benchmark::State &state) {
+    std::vector<Widget*> objects = makeObjects(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        Widget *object = objects[i];
+        benchmark::DoNotOptimize(object);
+        benchmark::DoNotOptimize(static_cast<x_Widget*>(object)->x_dynamicCast());
+        i = (i + 1) % objects.size();
+    }
+    deleteObjects(objects);
+}
+BENCHMARK(BM_DynamicCastCheck)->ArgName("object")->DenseRange(BindingObject, DerivedBindingObject);
+
+static void BM_CreatedByBindingCheck(benchmark::State &state) {
+    std::vector<Widget*> objects = makeObjects(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        Widget *object = objects[i];
+        benchmark::DoNotOptimize(object);
+        benchmark::DoNotOptimize(static_cast<x_Widget*>(object)->x_createdByBinding());
+        i = (i + 1) % objects.size();
+    }
+    deleteObjects(objects);
+}
+BENCHMARK(BM_CreatedByBindingCheck)->ArgName("object")->DenseRange(BindingObject, DerivedBindingObject);
@@ -0,0 +1,136 @@
+#include <smoke.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Smoke::enumValue() on a class with 600 enum members, about as many as the Qt namespace has. The members have
+// the xcall indices 100 to 699. Three modules: one with the EnumValues tables, and two without, whose classFn
+// either reads the values from a table after a range check (current smokegen) or calls one x_N function per
+// member from its switch (smokegen before the tables).
+
+#define ENUM_VALUE(n) ((long) (n) * 7 - 1000)
+
+#define ENUM_CASE(n) case n: x_enumMember<n>(args); break;
+#define ENUM_CASES10(p) ENUM_CASE(p##0) ENUM_CASE(p##1) ENUM_CASE(p##2) ENUM_CASE(p##3) ENUM_CASE(p##4) \
+                        ENUM_CASE(p##5) ENUM_CASE(p##6) ENUM_CASE(p##7) ENUM_CASE(p##8) ENUM_CASE(p##9)
+#define ENUM_CASES100(p) ENUM_CASES10(p##0) ENUM_CASES10(p##1) ENUM_CASES10(p##2) ENUM_CASES10(p##3) \
+                         ENUM_CASES10(p##4) ENUM_CASES10(p##5) ENUM_CASES10(p##6) ENUM_CASES10(p##7) \
+                         ENUM_CASES10(p##8) ENUM_CASES10(p##9)
+
+#define ENUM_ENTRY(n) ENUM_VALUE(n),
+#define ENUM_ENTRIES10(p) ENUM_ENTRY(p##0) ENUM_ENTRY(p##1) ENUM_ENTRY(p##2) ENUM_ENTRY(p##3) ENUM_ENTRY(p##4) \
+                          ENUM_ENTRY(p##5) ENUM_ENTRY(p##6) ENUM_ENTRY(p##7) ENUM_ENTRY(p##8) ENUM_ENTRY(p##9)
+#define ENUM_ENTRIES100(p) ENUM_ENTRIES10(p##0) ENUM_ENTRIES10(p##1) ENUM_ENTRIES10(p##2) ENUM_ENTRIES10(p##3) \
+                           ENUM_ENTRIES10(p##4) ENUM_ENTRIES10(p##5) ENUM_ENTRIES10(p##6) ENUM_ENTRIES10(p##7) \
+                           ENUM_ENTRIES10(p##8) ENUM_ENTRIES10(p##9)
+
+namespace {
+
+const int FirstEnumIndex = 100;
+const int NumEnumMembers = 600;
+
+const long xenum_values[NumEnumMembers] = {
+    ENUM_ENTRIES100(1) ENUM_ENTRIES100(2) ENUM_ENTRIES100(3) ENUM_ENTRIES100(4) ENUM_ENTRIES100(5) ENUM_ENTRIES100(6)
+};
+
+template <int N>
+void x_enumMember(Smoke::Stack x) {
+    x[0].s_enum = ENUM_VALUE(N);
+}
+
+void xcall_switch(Smoke::Index xi, void *, Smoke::Stack args) {
+    switch (xi) {
+        ENUM_CASES100(1) ENUM_CASES100(2) ENUM_CASES100(3) ENUM_CASES100(4) ENUM_CASES100(5) ENUM_CASES100(6)
+        default: break;
+    }
+}
+
+void xcall_table(Smoke::Index xi, void *, Smoke::Stack args) {
+    if (xi >= FirstEnumIndex && xi < FirstEnumIndex + NumEnumMembers) {
+        args[0].s_enum = xenum_values[xi - FirstEnumIndex];
+        return;
+    }
+    switch (xi) {
+        default: break;
+    }
+}
+
+const Smoke::EnumValues enumValues = { FirstEnumIndex, NumEnumMembers, xenum_values };
+const Smoke::EnumValues *const classEnumValues[] = { 0, &enumValues };
+
+enum ModuleKind {
+    EnumValueTables,
+    RangeCheckClassFn,
+    SwitchClassFn
+};
+
+class EnumModule {
+public:
+    explicit EnumModule(ModuleKind kind) {
+        Smoke::Class klass = { "Qt", false, 0, kind == SwitchClassFn ? xcall_switch : xcall_table, 0, Smoke::cf_namespace, 0 };
+        m_methodNames.push_back("");
+        m_methodNames.push_back("member");
+        m_classes.push_back(Smoke::Class());
+        m_classes.push_back(klass);
+        m_methods.push_back(Smoke::Method());
+        for (int i = 0; i < NumEnumMembers; ++i) {
+            Smoke::Method method = { 1, 1, 0, 0, Smoke::mf_static | Smoke::mf_enum, 0, (short) (FirstEnumIndex + i) };
+            m_methods.push_back(method);
+        }
+        m_methodMaps.push_back(Smoke::MethodMap());
+        m_types.push_back(Smoke::Type());
+        m_extraTables = Smoke::ExtraTables();
+        if (kind == EnumValueTables)
+            m_extraTables.classEnumValues = classEnumValues;
+        m_smoke = new Smoke("enums",
+                            m_classes.data(), 1,
+                            m_methods.data(), m_methods.size(),
+                            m_methodMaps.data(), 0,
+                            m_methodNames.data(), 1,
+                            m_types.data(), 0,
+                            m_emptyList, m_emptyList, m_emptyList,
+                            0,
+                            &m_extraTables);
+    }
+    ~EnumModule() {
+        delete m_smoke;
+    }
+
+    Smoke *smoke() const { return m_smoke; }
+
+private:
+    EnumModule(const EnumModule &);
+    EnumModule &operator=(const EnumModule &);
+
+    std::vector<const char *> m_methodNames;
+    std::vector<Smoke::Class> m_classes;
+    std::vector<Smoke::Method> m_methods;
+    std::vector<Smoke::MethodMap> m_methodMaps;
+    std::vector<Smoke::Type> m_types;
+    short m_emptyList[1] = { 0 };
+    Smoke::ExtraTables m_extraTables;
+    Smoke *m_smoke;
+};
+
+}
+
+// arg: the ModuleKind of the module
+
+static void BM_EnumValue(benchmark::State &state) {
+    EnumModule module((ModuleKind) state.range(0));
+    std::vector<Smoke::Index> methods;
+    for (int i = 1; i <= NumEnumMembers; ++i)
+        methods.push_back(i);
+    std::shuffle(methods.begin(), methods.end(), std::mt19937(7));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(module.smoke()->enumValue(methods[i]));
+        if (++i == methods.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EnumValue)->ArgName("module")->DenseRange(EnumValueTables, SwitchClassFn);
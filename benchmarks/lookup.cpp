@@ -0,0 +1,44 @@
+#include "syntheticmodule.h"
+
+#include <benchmark/benchmark.h>
+
+// Name lookups with the perfect hashes (arg 1) and with the binary search of modules without them (arg 0)
+
+static void BM_IdClass(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    const std::vector<const char *> names = SyntheticModule::shuffled(SyntheticModule::instance(state.range(0)).classNames());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(smoke->idClass(names[i]));
+        if (++i == names.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdClass)->ArgName("hash")->Arg(0)->Arg(SyntheticModule::NameHashes);
+
+static void BM_IdType(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    const std::vector<const char *> names = SyntheticModule::shuffled(SyntheticModule::instance(state.range(0)).typeNames());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(smoke->idType(names[i]));
+        if (++i == names.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdType)->ArgName("hash")->Arg(0)->Arg(SyntheticModule::NameHashes);
+
+static void BM_IdMethodName(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    const std::vector<const char *> names = SyntheticModule::shuffled(SyntheticModule::instance(state.range(0)).methodNames());
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(smoke->idMethodName(names[i]));
+        if (++i == names.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdMethodName)->ArgName("hash")->Arg(0)->Arg(SyntheticModule::NameHashes);
@@ -0,0 +1,58 @@
+#include "syntheticmodule.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Scans over all classes and methods, and idMethod(), reading the hot arrays (arg HotArrays) or the full Class,
+// Method and MethodMap entries (arg 0)
+
+static void BM_ClassScan(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    for (auto _ : state) {
+        int derived = 0;
+        for (Smoke::Index c = 1; c <= smoke->numClasses; ++c) {
+            if ((smoke->classFlags(c) & Smoke::cf_constructor) && smoke->classParents(c))
+                derived++;
+        }
+        benchmark::DoNotOptimize(derived);
+    }
+    state.SetItemsProcessed(state.iterations() * smoke->numClasses);
+}
+BENCHMARK(BM_ClassScan)->ArgName("hot")->Arg(0)->Arg(SyntheticModule::HotArrays);
+
+// all non-static methods with one name, like a binding collecting the candidates of a call
+static void BM_MethodScan(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    Smoke::Index name = 1;
+    for (auto _ : state) {
+        int found = 0;
+        for (Smoke::Index m = 1; m < smoke->numMethods; ++m) {
+            if (smoke->methodNameId(m) == name && !(smoke->methodFlags(m) & Smoke::mf_static))
+                found += smoke->methodClassId(m);
+        }
+        benchmark::DoNotOptimize(found);
+        if (++name > smoke->numMethodNames)
+            name = 1;
+    }
+    state.SetItemsProcessed(state.iterations() * (smoke->numMethods - 1));
+}
+BENCHMARK(BM_MethodScan)->ArgName("hot")->Arg(0)->Arg(SyntheticModule::HotArrays);
+
+static void BM_IdMethod(benchmark::State &state) {
+    Smoke *smoke = SyntheticModule::instance(state.range(0)).smoke();
+    std::vector<Smoke::WideMethodMap> lookups;
+    for (Smoke::Index i = 1; i < smoke->numMethodMaps; ++i)
+        lookups.push_back(smoke->methodMapEntry(i));
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(7));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(smoke->idMethod(lookups[i].classId, lookups[i].name));
+        if (++i == lookups.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdMethod)->ArgName("hot")->Arg(0)->Arg(SyntheticModule::HotArrays);
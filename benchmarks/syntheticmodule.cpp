@@ -0,0 +1,165 @@
+#include "syntheticmodule.h"
+
+#include <generators/smoke/namehash.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+
+namespace {
+
+void classFn(Smoke::Index, void *, Smoke::Stack args) {
+    args[0].s_voidp = 0;
+}
+
+// unique names like "QAbstractFooBar", sorted
+std::vector<std::string> randomNames(std::mt19937 &random, int count, const char *prefix, bool capitalize) {
+    static const char *const syllables[] = {
+        "ab", "stract", "item", "mod", "el", "view", "wid", "get", "text", "doc", "u", "ment", "lay", "out",
+        "pix", "map", "event", "fil", "ter", "graph", "ics", "scene", "proxy", "style", "option", "brush", "pen"
+    };
+    const int numSyllables = sizeof(syllables) / sizeof(syllables[0]);
+    std::set<std::string> names;
+    while ((int) names.size() < count) {
+        std::string name = prefix;
+        int length = 2 + random() % 5;
+        for (int i = 0; i < length; ++i) {
+            std::string syllable = syllables[random() % numSyllables];
+            if (capitalize && (i == 0 || random() % 2))
+                syllable[0] = syllable[0] - 'a' + 'A';
+            name += syllable;
+        }
+        names.insert(name);
+    }
+    return std::vector<std::string>(names.begin(), names.end());
+}
+
+}
+
+SyntheticModule::SyntheticModule(const char *name, unsigned int features) {
+    std::mt19937 random(42);
+    m_classNames = randomNames(random, NumClasses, "Q", true);
+    m_typeNames = randomNames(random, NumTypes, "const Q", true);
+    m_methodNames = randomNames(random, NumMethodNames, "", false);
+    static const char *const munging[] = { "", "$", "#", "$$", "?", "#$" };
+    for (std::size_t i = 0; i < m_methodNames.size(); ++i)
+        m_methodNames[i] += munging[random() % 6];
+    // the munging suffix can change the order, keep the table sorted
+    std::sort(m_methodNames.begin(), m_methodNames.end());
+    m_methodNames.erase(std::unique(m_methodNames.begin(), m_methodNames.end()), m_methodNames.end());
+
+    m_methodNamePointers.push_back("");
+    for (const std::string &methodName : m_methodNames)
+        m_methodNamePointers.push_back(methodName.c_str());
+
+    // every other class derives from a class before it
+    m_inheritanceList.push_back(0);
+    m_classes.push_back(Smoke::Class());
+    for (int c = 1; c <= NumClasses; ++c) {
+        Smoke::Class klass = { m_classNames[c - 1].c_str(), false, 0, classFn, 0, Smoke::cf_constructor, 16 };
+        if (c > 1 && random() % 2) {
+            klass.parents = m_inheritanceList.size();
+            m_inheritanceList.push_back(1 + random() % (c - 1));
+            m_inheritanceList.push_back(0);
+        }
+        m_classes.push_back(klass);
+    }
+
+    m_types.push_back(Smoke::Type());
+    for (const std::string &typeName : m_typeNames) {
+        Smoke::Type type = { typeName.c_str(), 0, Smoke::t_voidp | Smoke::tf_ptr };
+        m_types.push_back(type);
+    }
+    m_argumentList.push_back(0);
+    m_ambiguousMethodList.push_back(0);
+
+    // methods grouped by class, methodMaps sorted by class and name
+    m_methods.push_back(Smoke::Method());
+    m_methodMaps.push_back(Smoke::MethodMap());
+    m_methodMapKeys.push_back(0);
+    m_classMethods.assign(NumClasses + 2, 0);
+    m_classMethodMaps.assign(NumClasses + 2, 0);
+    m_classMethods[0] = m_classMethodMaps[0] = 1;
+    for (int c = 1; c <= NumClasses; ++c) {
+        m_classMethods[c] = m_methods.size();
+        m_classMethodMaps[c] = m_methodMaps.size();
+        std::set<short> names;
+        while ((int) names.size() < MethodsPerClass)
+            names.insert(1 + random() % m_methodNames.size());
+        short index = 0;
+        for (short methodName : names) {
+            Smoke::Method method = { (short) c, methodName, 0, 0, 0, 0, index++ };
+            Smoke::MethodMap methodMap = { (short) c, methodName, (short) m_methods.size() };
+            m_methods.push_back(method);
+            m_methodMaps.push_back(methodMap);
+            m_methodMapKeys.push_back(Smoke::methodMapKey(c, methodName));
+        }
+    }
+    m_classMethods[NumClasses + 1] = m_methods.size();
+    m_classMethodMaps[NumClasses + 1] = m_methodMaps.size();
+
+    for (const Smoke::Class &klass : m_classes) {
+        Smoke::HotClass hot = { klass.parents, klass.flags, klass.external };
+        m_hotClasses.push_back(hot);
+    }
+    for (const Smoke::Method &method : m_methods) {
+        Smoke::HotMethod hot = { method.classId, method.name, method.flags };
+        m_hotMethods.push_back(hot);
+    }
+
+    m_extraTables = Smoke::ExtraTables();
+    if (features & NameHashes) {
+        const std::vector<std::string> *names[3] = { &m_classNames, &m_typeNames, &m_methodNames };
+        Smoke::NameHash *hashes[3] = { &m_extraTables.classHash, &m_extraTables.typeHash, &m_extraTables.methodNameHash };
+        for (int i = 0; i < 3; ++i) {
+            std::vector<const char *> nameData;
+            for (const std::string &entry : *names[i])
+                nameData.push_back(entry.c_str());
+            buildNameHash(nameData, &m_hashDisplacements[i], &m_hashIndices[i]);
+            hashes[i]->size = names[i]->size();
+            hashes[i]->displacements = m_hashDisplacements[i].data();
+            hashes[i]->indices = m_hashIndices[i].data();
+        }
+    }
+    if (features & HotArrays) {
+        m_extraTables.hotClasses = m_hotClasses.data();
+        m_extraTables.hotMethods = m_hotMethods.data();
+        m_extraTables.methodMapKeys = m_methodMapKeys.data();
+    }
+    m_extraTables.classMethodMaps = m_classMethodMaps.data();
+    m_extraTables.classMethods = m_classMethods.data();
+
+    m_smoke = new Smoke(name,
+                        m_classes.data(), NumClasses,
+                        m_methods.data(), m_methods.size(),
+                        m_methodMaps.data(), m_methodMaps.size(),
+                        m_methodNamePointers.data(), m_methodNames.size(),
+                        m_types.data(), NumTypes,
+                        m_inheritanceList.data(),
+                        m_argumentList.data(),
+                        m_ambiguousMethodList.data(),
+                        0,
+                        &m_extraTables);
+}
+
+SyntheticModule::~SyntheticModule() {
+    delete m_smoke;
+}
+
+SyntheticModule &SyntheticModule::instance(unsigned int features) {
+    static std::map<unsigned int, std::unique_ptr<SyntheticModule> > modules;
+    std::unique_ptr<SyntheticModule> &module = modules[features];
+    if (!module)
+        module.reset(new SyntheticModule("synthetic", features));
+    return *module;
+}
+
+std::vector<const char *> SyntheticModule::shuffled(const std::vector<std::string> &names) {
+    std::vector<const char *> result;
+    for (const std::string &name : names)
+        result.push_back(name.c_str());
+    std::shuffle(result.begin(), result.end(), std::mt19937(7));
+    return result;
+}
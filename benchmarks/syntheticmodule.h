@@ -0,0 +1,63 @@
+#ifndef SYNTHETICMODULE_H
+#define SYNTHETICMODULE_H
+
+#include <smoke.h>
+
+#include <string>
+#include <vector>
+
+// A module with the table sizes and name shapes of a large Qt module, built at run time, so smokebase can be
+// measured without generating and compiling real bindings. The tables are filled like smokegen fills them:
+// sorted names, methods grouped by class, methodMaps sorted by class and name.
+class SyntheticModule {
+public:
+    enum Feature {
+        NameHashes = 0x01,  // perfect hashes of the class, type and method names
+        HotArrays = 0x02    // hot arrays and methodMapKeys (smokegen -hotcold)
+    };
+
+    static const int NumClasses = 2000;
+    static const int MethodsPerClass = 15;
+    static const int NumMethodNames = 12000;
+    static const int NumTypes = 4000;
+
+    SyntheticModule(const char *name, unsigned int features);
+    ~SyntheticModule();
+
+    // a module shared by all benchmarks that use the same features
+    static SyntheticModule &instance(unsigned int features);
+
+    Smoke *smoke() const { return m_smoke; }
+
+    const std::vector<std::string> &classNames() const { return m_classNames; }
+    const std::vector<std::string> &typeNames() const { return m_typeNames; }
+    const std::vector<std::string> &methodNames() const { return m_methodNames; }
+
+    // the names in a fixed random order, so lookups don't walk the tables in order
+    static std::vector<const char *> shuffled(const std::vector<std::string> &names);
+
+private:
+    SyntheticModule(const SyntheticModule &);
+    SyntheticModule &operator=(const SyntheticModule &);
+
+    std::vector<std::string> m_classNames, m_typeNames, m_methodNames;
+    std::vector<const char *> m_methodNamePointers;
+
+    std::vector<Smoke::Class> m_classes;
+    std::vector<Smoke::Method> m_methods;
+    std::vector<Smoke::MethodMap> m_methodMaps;
+    std::vector<Smoke::Type> m_types;
+    std::vector<short> m_inheritanceList, m_argumentList, m_ambiguousMethodList;
+
+    std::vector<int> m_hashDisplacements[3];
+    std::vector<Smoke::Index> m_hashIndices[3];
+    std::vector<Smoke::HotClass> m_hotClasses;
+    std::vector<Smoke::HotMethod> m_hotMethods;
+    std::vector<Smoke::MethodMapKey> m_methodMapKeys;
+    std::vector<Smoke::Index> m_classMethodMaps, m_classMethods;
+    Smoke::ExtraTables m_extraTables;
+
+    Smoke *m_smoke;
+};
+
+#endif
@@ -34,6 +34,9 @@ Smoke* loadSmokeModule(QFileInfo file) {
 
     if (!init)
         qFatal("Couldn't resolve %s: %s", qPrintable(init_name), qPrintable(lib.errorString()));
+
+    if (!Smoke::isSupportedIndexSize((const int*) lib.resolve(QString(moduleName + "_Smoke_indexSize").toLatin1())))
+        qFatal("%s has tables with an index size smokebase doesn't support", qPrintable(moduleName));
     (*init)();
 
     QString smoke_name = moduleName + "_Smoke";
@@ -74,19 +77,17 @@ int main(int argc, char** argv)
     }
 
     for (QHash<Smoke*, QSet<Smoke*> >::iterator iter = parents.begin(); iter != parents.end(); iter++) {
-        for (short i = 1; i <= iter.key()->numClasses; i++) {
-            Smoke::Class *klass = iter.key()->classes + i;
-
-            for (short* idx = iter.key()->inheritanceList + klass->parents; *idx; idx++) {
-                Smoke::Class *parentClass = iter.key()->classes + *idx;
-                if (!parentClass->external)
+        for (Smoke::Index i = 1; i <= iter.key()->numClasses; i++) {
+            for (Smoke::Index p = iter.key()->classParents(i); iter.key()->inheritanceListEntry(p); p++) {
+                Smoke::Index idx = iter.key()->inheritanceListEntry(p);
+                if (!iter.key()->isExternalClass(idx))
                     continue;
 
                 Smoke* parentModule = 0;
-                if ((parentModule = iter.key()->findClass(parentClass->className).smoke)) {
+                if ((parentModule = iter.key()->findClass(iter.key()->className(idx)).smoke)) {
                     iter.value().insert(parentModule);
                 } else {
-                    qWarning() << "WARNING: missing parent module for class" << parentClass->className;
+                    qWarning() << "WARNING: missing parent module for class" << iter.key()->className(idx);
                 }
             }
         }
@@ -39,6 +39,13 @@ QList<QFileInfo> Options::headerList;
 QStringList Options::classList;
 
 int Options::parts = 20;
+int Options::parallelism = 0;
+bool Options::unityBuild = false;
+bool Options::packedTables = false;
+bool Options::thunkTables = false;
+bool Options::returnBuffers = false;
+bool Options::wideIndex = false;
+bool Options::hotColdTables = false;
 QString Options::module = "qt";
 QStringList Options::parentModules;
 QDir Options::libDir;
@@ -55,6 +62,14 @@ static void showUsage()
     "Usage: generator -g smoke [smoke generator options] [other generator options] -- <headers>" << std::endl <<
     "    -m <module name> (default: 'qt')" << std::endl <<
     "    -p <parts> (default: 20)" << std::endl <<
+    "    -j <jobs> (distribute the classes over as many of the parts as suit <jobs> parallel compile jobs)" << std::endl <<
+    "    -unity (needs -j: fill one part per job, but no more than <parts>, and move the #includes most parts share" << std::endl <<
+    "           to x_preamble.h, which every part includes first, so the build can precompile it)" << std::endl <<
+    "    -packed (write the tables with names stored as offsets into a string pool, see Smoke::ExtraTables)" << std::endl <<
+    "    -thunks (write a table with one function per method for every class, see Smoke::thunk())" << std::endl <<
+    "    -returnbuffers (construct classes returned by value in buffers passed by the binding)" << std::endl <<
+    "    -wide (write the tables with 32 bit indexes, see Smoke::indexSize(); chosen automatically for modules that need them)" << std::endl <<
+    "    -hotcold (write dense arrays of the class and method fields read by scans and lookups)" << std::endl <<
     "    -pm <comma-seperated list of parent modules>" << std::endl <<
     "    -st <comma-seperated list of types that should be munged to scalars>" << std::endl <<
     "    -vt <comma-seperated list of types that should be mapped to Smoke::t_voidp>" << std::endl <<
@@ -70,7 +85,7 @@ int generate()
     
     const QStringList& args = QCoreApplication::arguments();
     for (int i = 0; i < args.count(); i++) {
-        if (  (args[i] == "-m" || args[i] == "-p" || args[i] == "-pm" || args[i] == "-o" ||
+        if (  (args[i] == "-m" || args[i] == "-p" || args[i] == "-j" || args[i] == "-pm" || args[i] == "-o" ||
                args[i] == "-st" || args[i] == "-vt" || args[i] == "-smokeconfig" || args[i] == "-L")
             && i + 1 >= args.count())
         {
@@ -85,6 +100,25 @@ int generate()
                 qCritical() << "generator_smoke: couldn't parse argument for option" << args[i - 1];
                 return EXIT_FAILURE;
             }
+        } else if (args[i] == "-j") {
+            bool ok = false;
+            Options::parallelism = args[++i].toInt(&ok);
+            if (!ok) {
+                qCritical() << "generator_smoke: couldn't parse argument for option" << args[i - 1];
+                return EXIT_FAILURE;
+            }
+        } else if (args[i] == "-unity") {
+            Options::unityBuild = true;
+        } else if (args[i] == "-packed") {
+            Options::packedTables = true;
+        } else if (args[i] == "-thunks") {
+            Options::thunkTables = true;
+        } else if (args[i] == "-returnbuffers") {
+            Options::returnBuffers = true;
+        } else if (args[i] == "-wide") {
+            Options::wideIndex = true;
+        } else if (args[i] == "-hotcold") {
+            Options::hotColdTables = true;
         } else if (args[i] == "-pm") {
             Options::parentModules = args[++i].split(',');
         } else if (args[i] == "-st") {
@@ -123,6 +157,20 @@ int generate()
                 Options::module = elem.text();
             } else if (elem.tagName() == "parts") {
                 Options::parts = elem.text().toInt();
+            } else if (elem.tagName() == "parallelism") {
+                Options::parallelism = elem.text().toInt();
+            } else if (elem.tagName() == "unityBuild") {
+                Options::unityBuild = (elem.text() == "true");
+            } else if (elem.tagName() == "packedTables") {
+                Options::packedTables = (elem.text() == "true");
+            } else if (elem.tagName() == "thunkTables") {
+                Options::thunkTables = (elem.text() == "true");
+            } else if (elem.tagName() == "returnBuffers") {
+                Options::returnBuffers = (elem.text() == "true");
+            } else if (elem.tagName() == "wideIndex") {
+                Options::wideIndex = (elem.text() == "true");
+            } else if (elem.tagName() == "hotColdTables") {
+                Options::hotColdTables = (elem.text() == "true");
             } else if (elem.tagName() == "parentModules") {
                 QDomNode parent = elem.firstChild();
                 while (!parent.isNull()) {
@@ -210,6 +258,11 @@ int generate()
         qWarning() << "Couldn't find config file" << smokeConfig.filePath();
     }
     
+    if (Options::unityBuild && Options::parallelism <= 0) {
+        qCritical() << "generator_smoke: -unity needs the number of compile jobs (-j or <parallelism>)";
+        return EXIT_FAILURE;
+    }
+
     if (!Options::outputDir.exists()) {
         qWarning() << "output directoy" << Options::outputDir.path() << "doesn't exist; creating it...";
         QDir::current().mkpath(Options::outputDir.path());
@@ -20,7 +20,9 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include <QHash>
 #include <QMap>
+#include <QRegExp>
 #include <QSet>
 #include <QString>
 #include <QStringList>
@@ -41,10 +43,35 @@ class Method;
 class Field;
 class Type;
 
+// Matches strings against a list of regular expressions at once. Plain strings are looked up in a hash,
+// the remaining expressions are combined into a single one and the result is cached for every string.
+// The expressions are compiled once, when the matcher is created, so it has to be created after the options
+// are read.
+struct PatternMatcher
+{
+    PatternMatcher(const QList<QRegExp>& expressions);
+    bool exactMatch(const QString& str);
+
+private:
+    void compile(const QList<QRegExp>& expressions);
+
+    QSet<QString> m_literals;
+    QRegExp m_combined;
+    QList<QRegExp> m_separate;
+    QHash<QString, bool> m_cache;
+};
+
 struct Options
 {
     static QDir outputDir;
     static int parts;
+    static int parallelism;
+    static bool unityBuild;
+    static bool packedTables;
+    static bool thunkTables;
+    static bool returnBuffers;
+    static bool wideIndex;
+    static bool hotColdTables;
     static QString module;
     static QStringList parentModules;
     static QDir libDir;
@@ -92,7 +119,9 @@ private:
     void generateMethod(QTextStream& out, const QString& className, const QString& smokeClassName, const Method& meth, int index, QSet<QString>& includes, bool privateDestructor);
     void generateGetAccessor(QTextStream& out, const QString& className, const Field& field, const Type* type, int index);
     void generateSetAccessor(QTextStream& out, const QString& className, const Field& field, const Type* type, int index);
-    void generateEnumMemberCall(QTextStream& out, const QString& parentName, const QString& className, bool isScoped, const QString& member, int index);
+    void generateEnumMemberCall(QTextStream& out, const QString& value, int index);
+    bool generateDefaultArgumentCall(QTextStream& out, const QString& className, const Method& meth, int index,
+                                     const Method& origin, int originIndex, bool privateDestructor);
     void generateVirtualMethod(QTextStream& out, const Method& meth, QSet<QString>& includes);
     
     void writeClass(QTextStream& out, const Class* klass, const QString& className, QSet<QString>& includes);
@@ -108,6 +137,7 @@ struct Util
     static QHash<const Method*, const Field*> fieldAccessors;
     
     static bool isVirtualInheritancePath(const Class* desc, const Class* super);
+    static bool baseClassOffset(const Class* desc, const Class* super, long long* offset);
     static QList<const Class*> superClassList(const Class* klass);
     static QList<const Class*> descendantsList(const Class* klass);
 
@@ -120,12 +150,14 @@ struct Util
     static const Method* findDestructor(const Class* klass);
 
     static bool derivesFromInvalid(const Class* klass);
+    static int enumMemberCount(const Class* klass);
 
     static void checkForAbstractClass(Class* klass);
     static void addDefaultConstructor(Class* klass);
     static void addCopyConstructor(Class* klass);
     static void addDestructor(Class* klass);
     static void addOverloads(const Method& meth);
+    static const Method* defaultArgumentOrigin(const Method& overload);
     static void addAccessorMethods(const Field& field, QSet<Type*> *usedTypes);
 
     static QChar munge(const Type *type);
@@ -135,7 +167,7 @@ struct Util
     static bool hasTypeNonPublicParts(const Type& type);
 
     static QString stackItemField(const Type* type);
-    static QString assignmentString(const Type* type, const QString& var);
+    static QString assignmentString(const Type* type, const QString& var, const QString& buffer = QString());
     static QList<const Method*> collectVirtualMethods(const Class* klass);
     static const Method* isVirtualOverriden(const Method& meth, const Class* klass);
     static QList<const Method*> virtualMethodsForClass(const Class* klass);
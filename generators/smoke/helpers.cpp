@@ -17,17 +17,21 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <QFile>
 #include <QFileInfo>
 #include <QHash>
 #include <QList>
 #include <QLibrary>
 #include <QStack>
 #include <QDir>
+#include <QDataStream>
+#include <QVector>
 
 #include <type.h>
 #include <smoke.h>
 
 #include "globals.h"
+#include "smokemeta.h"
 #include "../../options.h"
 
 using InitSmokeFn = void (*)();
@@ -56,6 +60,22 @@ bool Util::isVirtualInheritancePath(const Class* desc, const Class* super)
     return isVirtual;
 }
 
+// Sets 'offset' to the position of 'super' in 'desc', as laid out by clang. Returns false if 'super' isn't a
+// non-virtual base class of 'desc' or if the layout of a class on the way isn't known.
+bool Util::baseClassOffset(const Class* desc, const Class* super, long long* offset)
+{
+    for (const Class::BaseClassSpecifier& bspec : desc->baseClasses()) {
+        if (bspec.offset < 0)
+            continue;
+        long long baseOffset = 0;
+        if (bspec.baseClass == super || baseClassOffset(bspec.baseClass, super, &baseOffset)) {
+            *offset = bspec.offset + baseOffset;
+            return true;
+        }
+    }
+    return false;
+}
+
 QList<const Class*> Util::superClassList(const Class* klass)
 {
     static QHash<const Class*, QList<const Class*> > superClassCache;
@@ -129,6 +149,11 @@ static Smoke* loadSmokeModule(QString moduleName) {
         return 0;
     }
 
+    if (!Smoke::isSupportedIndexSize((const int*) lib.resolve(QString(moduleName + "_Smoke_indexSize").toLatin1()))) {
+        qWarning("%s has tables with an index size smokebase doesn't support", qPrintable(moduleName));
+        return 0;
+    }
+
     (*init)();
 
     QString smoke_name = moduleName + "_Smoke";
@@ -141,56 +166,164 @@ static Smoke* loadSmokeModule(QString moduleName) {
     return *smoke;
 }
 
-static bool compareArgs(const Method& method, const Smoke::Method& smokeMethod, Smoke* smoke) {
-    if (method.parameters().count() != smokeMethod.numArgs) {
+// Key of a method in the index of the parent modules: class name, method name and argument types.
+static QString methodKey(const QString& className, const QString& name, const QStringList& argTypes)
+{
+    return className + "::" + name + '(' + argTypes.join(";") + ')';
+}
+
+// Adds all methods and enum members of a parent module to 'index' in a single pass over its tables,
+// so each isRepeating() check is just one hash lookup.
+static void indexSmokeModule(Smoke* smoke, QSet<QString>* index)
+{
+    for (Smoke::Index i = 1; i < smoke->numMethods; i++) {
+        const Smoke::WideMethod meth = smoke->methodEntry(i);
+        QStringList argTypes;
+        for (int j = 0; j < meth.numArgs; j++) {
+            argTypes << QLatin1String(smoke->typeName(smoke->argumentListEntry(meth.args + j)));
+        }
+        index->insert(methodKey(QLatin1String(smoke->className(meth.classId)),
+                                QLatin1String(smoke->methodName(meth.name)), argTypes));
+    }
+}
+
+// Indexes a parent module from the <module>.smokemeta file written along with its smokedata.cpp, which avoids
+// loading the module's library, and adds the module's own parents to 'parents'. Returns false if there is no usable
+// file, so the library has to be loaded instead.
+static bool indexSmokeMeta(const QString& moduleName, QSet<QString>* index, QStringList* parents)
+{
+    QString fileName = moduleName + ".smokemeta";
+    QFile file(Options::libDir.filePath(moduleName + '/' + fileName));
+    if (!file.exists())
+        file.setFileName(Options::libDir.filePath(fileName));
+    if (!file.open(QIODevice::ReadOnly) || file.size() < SmokeMeta::HeaderSize)
+        return false;
+
+    QDataStream stream(&file);
+    SmokeMeta::openStream(stream);
+    SmokeMeta::Header header;
+    stream >> header;
+    if (header.magic != SmokeMeta::Magic || header.version != SmokeMeta::Version) {
+        qWarning("%s has an unknown format, loading the library instead", qPrintable(file.fileName()));
+        return false;
+    }
+
+    // check the size before allocating the tables
+    const quint64 expectedSize = SmokeMeta::HeaderSize + header.numClasses * SmokeMeta::ClassSize
+        + header.numTypes * SmokeMeta::TypeSize + header.numMethods * SmokeMeta::MethodSize
+        + ((quint64) header.numInheritance + header.numArguments + header.numParents) * SmokeMeta::IndexSize
+        + header.stringsSize;
+    if (expectedSize != (quint64) file.size() || !header.stringsSize) {
+        qWarning("%s is corrupt, loading the library instead", qPrintable(file.fileName()));
         return false;
     }
-    for (int i = 0; i < method.parameters().count(); i++) {
-        const Parameter& p = method.parameters()[i];
-        if (p.type()->toString() != QLatin1String(smoke->types[smoke->argumentList[smokeMethod.args + i]].name)) {
+
+    QVector<SmokeMeta::Class> classes(header.numClasses);
+    QVector<SmokeMeta::Type> types(header.numTypes);
+    QVector<SmokeMeta::Method> methods(header.numMethods);
+    QVector<qint32> inheritanceList(header.numInheritance);
+    QVector<qint32> argumentList(header.numArguments);
+    QVector<quint32> parentNames(header.numParents);
+    QByteArray stringData(header.stringsSize, '\0');
+    for (int i = 0; i < classes.size(); i++)
+        stream >> classes[i];
+    for (int i = 0; i < types.size(); i++)
+        stream >> types[i];
+    for (int i = 0; i < methods.size(); i++)
+        stream >> methods[i];
+    for (int i = 0; i < inheritanceList.size(); i++)
+        stream >> inheritanceList[i];
+    for (int i = 0; i < argumentList.size(); i++)
+        stream >> argumentList[i];
+    for (int i = 0; i < parentNames.size(); i++)
+        stream >> parentNames[i];
+    stream.readRawData(stringData.data(), stringData.size());
+    const char* strings = stringData.constData();
+
+    if (stream.status() != QDataStream::Ok || strings[header.stringsSize - 1] != '\0') {
+        qWarning("%s is corrupt, loading the library instead", qPrintable(file.fileName()));
+        return false;
+    }
+
+    QSet<QString> moduleIndex;
+    for (quint32 i = 1; i < header.numMethods; i++) {
+        const SmokeMeta::Method& meth = methods[i];
+        if ((quint32) meth.classId >= header.numClasses || classes[meth.classId].name >= header.stringsSize
+            || meth.name >= header.stringsSize
+            || meth.args < 0 || meth.numArgs < 0 || (quint32) (meth.args + meth.numArgs) > header.numArguments)
+        {
+            qWarning("%s is corrupt, loading the library instead", qPrintable(file.fileName()));
+            return false;
+        }
+        QStringList argTypes;
+        for (int j = 0; j < meth.numArgs; j++) {
+            quint32 type = argumentList[meth.args + j];
+            if (type >= header.numTypes || types[type].name >= header.stringsSize) {
+                qWarning("%s is corrupt, loading the library instead", qPrintable(file.fileName()));
+                return false;
+            }
+            argTypes << QLatin1String(strings + types[type].name);
+        }
+        moduleIndex.insert(methodKey(QLatin1String(strings + classes[meth.classId].name),
+                                     QLatin1String(strings + meth.name), argTypes));
+    }
+
+    QStringList moduleParents;
+    foreach (quint32 name, parentNames) {
+        if (name >= header.stringsSize) {
+            qWarning("%s is corrupt, loading the library instead", qPrintable(file.fileName()));
             return false;
         }
+        moduleParents << QLatin1String(strings + name);
     }
+
+    *index += moduleIndex;
+    *parents += moduleParents;
     return true;
 }
 
-static bool isRepeating(const QList<Smoke*>& parentModules, const char* className, const Method& method) {
-    QString mungedName = Util::mungedName(method).toLatin1();
-    for (Smoke* smoke : parentModules) {
-        Smoke::ModuleIndex methodIndex = smoke->findMethod(className, mungedName.toLatin1().constData());
-        if (methodIndex.index) {
-            Smoke::Index index = methodIndex.smoke->methodMaps[methodIndex.index].method;
-            if (index >= 0) {
-                if (compareArgs(method, methodIndex.smoke->methods[index], methodIndex.smoke)) {
-                    return true;
-                }
-                continue;
-            }
-            index = -index;
-            Smoke::Index i;
-            while ((i = methodIndex.smoke->ambiguousMethodList[index++]) != 0) {
-                if (compareArgs(method, methodIndex.smoke->methods[i], methodIndex.smoke)) {
-                    return true;
-                }
-            }
+// Indexes the parent modules and, like the classMap lookups smokegen used to do, their own parents in turn, so
+// nothing a grandparent module already has is generated again. Modules without a .smokemeta file are loaded; their
+// Smoke objects stay alive, since the libraries stay loaded and keep pointing to them.
+static void indexParentModules(QStringList modules, QSet<QString>* index)
+{
+    QSet<QString> seen;
+    QSet<QString> indexed;
+    bool loadedLibrary = false;
+    while (!modules.isEmpty()) {
+        const QString module = modules.takeFirst();
+        if (seen.contains(module))
+            continue;
+        seen << module;
+        if (indexSmokeMeta(module, index, &modules))
+            indexed << module;
+        else if (loadSmokeModule(module))
+            loadedLibrary = true;
+    }
+
+    // a loaded library also created the Smoke objects of all of its parents
+    if (loadedLibrary) {
+        for (Smoke* smoke : Smoke::loadedModules()) {
+            if (!indexed.contains(QLatin1String(smoke->moduleName())))
+                indexSmokeModule(smoke, index);
         }
     }
-    return false;
+}
+
+static bool isRepeating(const QSet<QString>& parentMethods, const QString& className, const Method& method) {
+    QStringList argTypes;
+    for (const Parameter& param : method.parameters()) {
+        argTypes << param.type()->toString();
+    }
+    return parentMethods.contains(methodKey(className, method.name(), argTypes));
 }
 
 // assuming that enums don't change between modules, checking for the first member only is sufficient
-static bool isRepeating(const QList<Smoke*>& parentModules, const char* className, const Enum& eNum) {
+static bool isRepeating(const QSet<QString>& parentMethods, const QString& className, const Enum& eNum) {
     if (eNum.members().isEmpty())
         return false;
 
-    const EnumMember& firstMember = eNum.members().first();
-
-    foreach(Smoke *smoke, parentModules) {
-        Smoke::ModuleIndex methodIndex = smoke->findMethod(className, firstMember.name().toLatin1().constData());
-        if (methodIndex.index)
-            return true;
-    }
-    return false;
+    return parentMethods.contains(methodKey(className, eNum.members().first().name(), QStringList()));
 }
 
 void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, const QList<QString>& keys)
@@ -200,13 +333,8 @@ void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, co
     globalSpace.setKind(Class::Kind_Class);
     globalSpace.setIsNameSpace(true);
 
-    QList<Smoke*> parentModules;
-    for (QString module : Options::parentModules) {
-        Smoke *smoke = loadSmokeModule(module);
-        if (smoke) {
-            parentModules << smoke;
-        }
-    }
+    QSet<QString> parentMethods;
+    indexParentModules(Options::parentModules, &parentMethods);
 
     // add all functions as methods to a class called 'QGlobalSpace' or a class that represents a namespace
     for (QHash<QString, Function>::const_iterator it = functions.constBegin(); it != functions.constEnd(); it++) {
@@ -242,7 +370,7 @@ void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, co
         
         Method meth = Method(parent, fn.name(), fn.type(), Access_public, fn.parameters());
         meth.setFlag(Method::Static);
-        if (isRepeating(parentModules, parent->name().toLatin1(), meth)) {
+        if (isRepeating(parentMethods, parent->name(), meth)) {
             continue;
         }
         parent->appendMethod(meth);
@@ -274,7 +402,7 @@ void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, co
                     parent->setIsNameSpace(true);
                 }
             // else, see if it is already defined in a parent module
-            } else if (isRepeating(parentModules, parent->name().toLatin1(), e)) {
+            } else if (isRepeating(parentMethods, parent->name(), e)) {
                 continue;
             }
             // Top-level enums have to be explicitly included
@@ -297,10 +425,6 @@ void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, co
         }
     }
 
-    for (Smoke* smoke : parentModules) {
-        delete smoke;
-    }
-
     for (const QString& key : keys) {
         Class& klass = classes[key];
         for (const Class::BaseClassSpecifier base : klass.baseClasses()) {
@@ -369,6 +493,17 @@ void Util::preparse(QSet<Type*> *usedTypes, QSet<const Class*> *superClasses, co
     }
 }
 
+int Util::enumMemberCount(const Class* klass)
+{
+    int count = 0;
+    for (const BasicTypeDeclaration* decl : klass->children()) {
+        const Enum* e = dynamic_cast<const Enum*>(decl);
+        if (e && e->access() != Access_private)
+            count += e->members().count();
+    }
+    return count;
+}
+
 bool Util::canClassBeInstanciated(const Class* klass)
 {
     static QHash<const Class*, bool> cache;
@@ -692,11 +827,11 @@ QString Util::stackItemField(const Type* type)
     return "s_" + typeName;
 }
 
-QString Util::assignmentString(const Type* type, const QString& var)
+QString Util::assignmentString(const Type* type, const QString& var, const QString& buffer)
 {
     if (type->getTypedef()) {
         Type resolved = type->getTypedef()->resolve();
-        return assignmentString(&resolved, var);
+        return assignmentString(&resolved, var, buffer);
     }
 
     if (type->pointerDepth() > 0 || type->isFunctionPointer()) {
@@ -713,6 +848,10 @@ QString Util::assignmentString(const Type* type, const QString& var)
     } else {
         QString ret = "(void*)new " + type->toString();
         ret += '(' + var + ')';
+        if (!buffer.isEmpty()) {
+            // construct the object in the buffer, if the caller passed one
+            ret = QString("(%1 ? (void*)new (%1) %2(%3) : %4)").arg(buffer).arg(type->toString()).arg(var).arg(ret);
+        }
         return ret;
     }
     return QString();
@@ -836,6 +975,31 @@ void Util::addOverloads(const Method& meth)
     }
 }
 
+// returns the method an overload added by addOverloads() was made from, i.e. the one that takes all the arguments
+const Method* Util::defaultArgumentOrigin(const Method& overload)
+{
+    const int numArgs = overload.parameters().count() + overload.remainingDefaultValues().count();
+    for (const Method& meth : overload.getClass()->methods()) {
+        if (!meth.remainingDefaultValues().isEmpty() || meth.parameters().count() != numArgs
+            || meth.name() != overload.name() || meth.isConst() != overload.isConst()
+            || meth.isConstructor() != overload.isConstructor()
+            || (meth.flags() & Method::Static) != (overload.flags() & Method::Static))
+        {
+            continue;
+        }
+        bool match = true;
+        for (int i = 0; i < overload.parameters().count() && match; i++) {
+            match = (meth.parameters()[i].type() == overload.parameters()[i].type());
+        }
+        for (int i = overload.parameters().count(); i < numArgs && match; i++) {
+            match = meth.parameters()[i].isDefault();
+        }
+        if (match)
+            return &meth;
+    }
+    return 0;
+}
+
 // checks if method meth is overriden in class klass or any of its superclasses
 const Method* Util::isVirtualOverriden(const Method& meth, const Class* klass)
 {
@@ -913,27 +1077,62 @@ QList<const Method*> Util::virtualMethodsForClass(const Class* klass)
     return ret;
 }
 
-bool Options::typeExcluded(const QString& typeName)
+PatternMatcher::PatternMatcher(const QList<QRegExp>& expressions)
 {
-    for (const QRegExp& exp : Options::excludeExpressions) {
-        if (exp.exactMatch(typeName))
-            return true;
+    compile(expressions);
+}
+
+void PatternMatcher::compile(const QList<QRegExp>& expressions)
+{
+    static const QRegExp specialChars("[\\\\^$.|?*+()\\[\\]{}]");
+    static const QRegExp backReference("\\\\[1-9]");
+
+    m_literals.clear();
+    m_separate.clear();
+    m_cache.clear();
+
+    QStringList alternatives;
+    for (const QRegExp& exp : expressions) {
+        if (exp.patternSyntax() != QRegExp::RegExp || exp.caseSensitivity() != Qt::CaseSensitive) {
+            m_separate << exp;
+        } else if (!exp.pattern().contains(specialChars)) {
+            m_literals << exp.pattern();
+        } else if (exp.pattern().contains(backReference)) {
+            // the group numbers would change in the combined expression
+            m_separate << exp;
+        } else {
+            alternatives << "(?:" + exp.pattern() + ')';
+        }
     }
-    return false;
+    m_combined = QRegExp(alternatives.join("|"));
 }
 
-bool Options::functionNameIncluded(const QString& fnName) {
-    for (const QRegExp& exp : Options::includeFunctionNames) {
-        if (exp.exactMatch(fnName))
-            return true;
+bool PatternMatcher::exactMatch(const QString& str)
+{
+    QHash<QString, bool>::const_iterator it = m_cache.constFind(str);
+    if (it != m_cache.constEnd())
+        return *it;
+
+    bool ret = m_literals.contains(str) || (!m_combined.isEmpty() && m_combined.exactMatch(str));
+    for (int i = 0; !ret && i < m_separate.count(); i++) {
+        ret = m_separate[i].exactMatch(str);
     }
-    return false;
+    m_cache.insert(str, ret);
+    return ret;
+}
+
+bool Options::typeExcluded(const QString& typeName)
+{
+    static PatternMatcher matcher(Options::excludeExpressions);
+    return matcher.exactMatch(typeName);
+}
+
+bool Options::functionNameIncluded(const QString& fnName) {
+    static PatternMatcher matcher(Options::includeFunctionNames);
+    return matcher.exactMatch(fnName);
 }
 
 bool Options::functionSignatureIncluded(const QString& sig) {
-    for (const QRegExp& exp : Options::includeFunctionNames) {
-        if (exp.exactMatch(sig))
-            return true;
-    }
-    return false;
+    static PatternMatcher matcher(Options::includeFunctionSignatures);
+    return matcher.exactMatch(sig);
 }
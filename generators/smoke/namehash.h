@@ -0,0 +1,85 @@
+/*
+    Generator for the SMOKE sources
+    Copyright (C) 2009 Arno Rehn <arno@arnorehn.de>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef NAMEHASH_H
+#define NAMEHASH_H
+
+#include <smoke.h>
+
+#include <algorithm>
+#include <vector>
+
+// Builds a hash and displace perfect hash (see Smoke::NameHash) over 'names', where names[i] has the index i + 1.
+// Buckets with several names get the first displacement that puts all of them into free slots, the remaining
+// single names are stored directly in the slots that are left. Returns false if no displacement was found.
+// Only needs smoke.h, so the benchmarks can build their hashes with the same code as smokegen.
+inline bool buildNameHash(const std::vector<const char*>& names, std::vector<int>* displacements, std::vector<int>* indices)
+{
+    const unsigned int size = names.size();
+    std::vector<std::vector<int> > buckets(size);
+    for (unsigned int i = 0; i < size; i++) {
+        buckets[Smoke::hashName(names[i], 0) % size].push_back(i);
+    }
+
+    // the largest buckets first, as they're the hardest to place; equal sizes by descending bucket
+    std::vector<unsigned int> bucketsBySize;
+    for (unsigned int b = 0; b < size; b++) {
+        if (buckets[b].size() > 1)
+            bucketsBySize.push_back(b);
+    }
+    std::sort(bucketsBySize.begin(), bucketsBySize.end(), [&buckets](unsigned int a, unsigned int b) {
+        return buckets[a].size() != buckets[b].size() ? buckets[a].size() > buckets[b].size() : a > b;
+    });
+
+    displacements->assign(size, 0);
+    indices->assign(size, 0);
+    for (unsigned int b : bucketsBySize) {
+        const std::vector<int>& bucket = buckets[b];
+        std::vector<unsigned int> slots;
+        int d = 1;
+        while (slots.size() < bucket.size()) {
+            if (d > 0x100000)
+                return false;
+            unsigned int slot = Smoke::hashName(names[bucket[slots.size()]], d) % size;
+            if ((*indices)[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                slots.clear();
+                d++;
+                continue;
+            }
+            slots.push_back(slot);
+        }
+        (*displacements)[b] = d;
+        for (std::size_t i = 0; i < bucket.size(); i++) {
+            (*indices)[slots[i]] = bucket[i] + 1;
+        }
+    }
+
+    unsigned int freeSlot = 0;
+    for (unsigned int b = 0; b < size; b++) {
+        if (buckets[b].size() != 1)
+            continue;
+        while ((*indices)[freeSlot])
+            freeSlot++;
+        (*displacements)[b] = -int(freeSlot) - 1;
+        (*indices)[freeSlot] = buckets[b].front() + 1;
+    }
+    return true;
+}
+
+#endif
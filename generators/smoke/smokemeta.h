@@ -0,0 +1,121 @@
+/*
+    Generator for the SMOKE sources
+    Copyright (C) 2009 Arno Rehn <arno@arnorehn.de>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef SMOKEMETA_H
+#define SMOKEMETA_H
+
+#include <QDataStream>
+#include <QtGlobal>
+
+// Layout of the <module>.smokemeta files written next to smokedata.cpp. They contain the class, type, method
+// and inheritance tables of a module, so modules depending on it can be generated without loading its library.
+// Every table starts with an empty entry 0, just like the ones in smokedata.cpp. They're followed by the names of
+// the module's own parent modules, without an entry 0. Names are offsets into the string table at the end of the
+// file.
+//
+// The structs below only describe the entries. In the file, each field is written on its own as a 32 bit
+// little-endian integer, in the order they're declared in, so the files don't depend on the byte order, padding
+// or integer sizes of the smokegen that wrote them. Use the stream operators with openStream().
+namespace SmokeMeta {
+
+const quint32 Magic = 0x4d4b4d53;   // "SMKM"
+const quint32 Version = 3;
+
+// sizes in the file
+const qint64 HeaderSize = 9 * 4;
+const qint64 ClassSize = 4 * 4;
+const qint64 TypeSize = 3 * 4;
+const qint64 MethodSize = 6 * 4;
+const qint64 IndexSize = 4;     // inheritance and argument list entries, parent module names
+
+struct Header {
+    quint32 magic;
+    quint32 version;
+    quint32 numClasses;
+    quint32 numTypes;
+    quint32 numMethods;
+    quint32 numInheritance;
+    quint32 numArguments;
+    quint32 numParents;
+    quint32 stringsSize;
+};
+
+struct Class {
+    quint32 name;
+    qint32 parents;     // index into the inheritance list
+    quint32 flags;      // Smoke::ClassFlags
+    quint32 external;
+};
+
+struct Type {
+    quint32 name;
+    qint32 classId;
+    quint32 flags;      // Smoke::TypeFlags
+};
+
+struct Method {
+    qint32 classId;
+    quint32 name;
+    qint32 args;        // index into the argument list
+    qint32 numArgs;
+    quint32 flags;      // Smoke::MethodFlags
+    qint32 ret;
+};
+
+inline void openStream(QDataStream& stream) {
+    stream.setByteOrder(QDataStream::LittleEndian);
+}
+
+inline QDataStream& operator<<(QDataStream& s, const Header& h) {
+    return s << h.magic << h.version << h.numClasses << h.numTypes << h.numMethods << h.numInheritance
+             << h.numArguments << h.numParents << h.stringsSize;
+}
+
+inline QDataStream& operator>>(QDataStream& s, Header& h) {
+    return s >> h.magic >> h.version >> h.numClasses >> h.numTypes >> h.numMethods >> h.numInheritance
+             >> h.numArguments >> h.numParents >> h.stringsSize;
+}
+
+inline QDataStream& operator<<(QDataStream& s, const Class& c) {
+    return s << c.name << c.parents << c.flags << c.external;
+}
+
+inline QDataStream& operator>>(QDataStream& s, Class& c) {
+    return s >> c.name >> c.parents >> c.flags >> c.external;
+}
+
+inline QDataStream& operator<<(QDataStream& s, const Type& t) {
+    return s << t.name << t.classId << t.flags;
+}
+
+inline QDataStream& operator>>(QDataStream& s, Type& t) {
+    return s >> t.name >> t.classId >> t.flags;
+}
+
+inline QDataStream& operator<<(QDataStream& s, const Method& m) {
+    return s << m.classId << m.name << m.args << m.numArgs << m.flags << m.ret;
+}
+
+inline QDataStream& operator>>(QDataStream& s, Method& m) {
+    return s >> m.classId >> m.name >> m.args >> m.numArgs >> m.flags >> m.ret;
+}
+
+}
+
+#endif
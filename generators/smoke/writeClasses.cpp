@@ -39,27 +39,180 @@ void SmokeClassFiles::write()
     write(m_smokeData->includedClasses);
 }
 
+// Rough weights for how much a class adds to the compile time of an x_*.cpp file.
+static const int includeCost = 20;
+static const int methodCost = 2;
+static const int virtualMethodCost = 5;
+static const int templateArgumentCost = 3;
+
+static int templateArgumentCount(const Type* type)
+{
+    int count = type->templateArguments().count();
+    for (const Type& t : type->templateArguments()) {
+        count += templateArgumentCount(&t);
+    }
+    return count;
+}
+
+// Estimates how expensive the generated code for a class is to compile, based on the number of methods,
+// virtual method overrides, template-heavy signatures and the headers it pulls in.
+static int compileCost(const Class* klass, const QSet<QString>& includes)
+{
+    int cost = 1 + includes.count() * includeCost;
+    for (const Method& meth : klass->methods()) {
+        if (meth.access() == Access_private)
+            continue;
+        cost += methodCost + templateArgumentCount(meth.type()) * templateArgumentCost;
+        for (const Parameter& param : meth.parameters()) {
+            cost += templateArgumentCount(param.type()) * templateArgumentCost;
+        }
+    }
+    cost += Util::virtualMethodsForClass(klass).count() * virtualMethodCost;
+    return cost;
+}
+
+// Splits the classes into 'parts' contiguous ranges of roughly equal cost and returns the index of the first
+// class of each range (plus the total count at the end). The classes stay in alphabetical order, so a change
+// to one class only moves the boundaries next to it instead of reshuffling all files.
+static QList<int> partitionByCost(const QList<int>& costs, int parts)
+{
+    qint64 total = 0;
+    for (int cost : costs) {
+        total += cost;
+    }
+
+    QList<int> boundaries;
+    boundaries << 0;
+    qint64 sum = 0;
+    int i = 0;
+    for (int part = 1; part < parts; part++) {
+        qint64 target = total * part / parts;
+        // advance as long as taking the next class brings us closer to the target
+        while (i < costs.count() && qAbs(sum + costs[i] - target) <= qAbs(sum - target)) {
+            sum += costs[i++];
+        }
+        boundaries << i;
+    }
+    boundaries << costs.count();
+    return boundaries;
+}
+
+// A part should be big enough to make up for parsing the headers once more, but not so big that it
+// holds up the whole build.
+static const int minPartCost = 3000;
+static const int maxPartCost = 20000;
+
+// Picks the number of parts for a build with 'jobs' parallel compile jobs.
+static int partCount(qint64 totalCost, int jobs)
+{
+    if (Options::unityBuild)
+        return jobs;
+
+    int parts = qBound(qint64(1), totalCost / minPartCost, qint64(jobs));
+    if (totalCost / parts > maxPartCost) {
+        // use a multiple of the jobs, smaller parts give the scheduler room to make up for bad estimates
+        int rounds = (totalCost + qint64(jobs) * maxPartCost - 1) / (qint64(jobs) * maxPartCost);
+        parts = jobs * rounds;
+    }
+    return parts;
+}
+
+static void writeIncludes(QTextStream& out, const QSet<QString>& includes)
+{
+    QList<QString> sortedIncludes = includes.toList();
+    qSort(sortedIncludes.begin(), sortedIncludes.end());
+    for (QString& str : sortedIncludes) {
+        if (str.isEmpty())
+            continue;
+        if (str.startsWith("/builtins/"))
+            str.remove(0, 10);
+        out << "#include <" << str << ">\n";
+    }
+}
+
 void SmokeClassFiles::write(const QList<QString>& keys)
 {
     qDebug("writing out x_*.cpp [%s]", qPrintable(Options::module));
-    
-    // how many classes go in one file
-    int count = keys.count() / Options::parts;
-    int count2 = count;
-    
+
+    // write the class code to QStrings first, so we know how expensive each class is before distributing
+    // them over the files and can later prepend the #includes
+    QList<QString> classCode;
+    QList<QSet<QString> > classIncludes;
+    QList<int> costs;
+    qint64 totalCost = 0;
+    foreach (const QString& str, keys) {
+        const Class* klass = &classes[str];
+        QString code;
+        QTextStream classOut(&code);
+        QSet<QString> includes;
+        includes.insert(klass->fileName());
+        writeClass(classOut, klass, str, includes);
+        classCode << code;
+        classIncludes << includes;
+        costs << compileCost(klass, includes);
+        totalCost += costs.last();
+    }
+
+    // Options::parts is the number of files the build expects, with a target parallelism we only fill as
+    // many of them as are worth compiling separately and leave the rest empty
+    int usedParts = Options::parts;
+    if (Options::parallelism > 0) {
+        usedParts = qMin(partCount(totalCost, Options::parallelism), Options::parts);
+        // the build compiles a fixed list of -p files, so it can't get more parts than that
+        if (Options::unityBuild && Options::parallelism > Options::parts)
+            qWarning("-unity with %d jobs, but only %d parts: raise -p to get one part per job", Options::parallelism, Options::parts);
+        qDebug("distributing %d classes over %d of %d parts", keys.count(), usedParts, Options::parts);
+    }
+
+    QList<int> boundaries = partitionByCost(costs, usedParts);
+    while (boundaries.count() < Options::parts + 1) {
+        boundaries << keys.count();
+    }
+
+    // the number of parts that actually got classes, the remaining ones are left empty
+    int filledParts = 0;
+    QList<QSet<QString> > partIncludes;
+    QHash<QString, int> includeUsage;
     for (int i = 0; i < Options::parts; i++) {
+        if (boundaries[i] < boundaries[i + 1])
+            filledParts++;
         QSet<QString> includes;
-        QString classCode;
-        QTextStream classOut(&classCode);
-        
-        // write the class code to a QString so we can later prepend the #includes
-        if (i == Options::parts - 1) count2 = -1;
-        foreach (const QString& str, keys.mid(count * i, count2)) {
-            const Class* klass = &classes[str];
-            includes.insert(klass->fileName());
-            writeClass(classOut, klass, str, includes);
+        for (int j = boundaries[i]; j < boundaries[i + 1]; j++) {
+            includes += classIncludes[j];
         }
-        
+        foreach (const QString& include, includes) {
+            includeUsage[include]++;
+        }
+        partIncludes << includes;
+    }
+
+    // In a unity build, headers used by at least half of the parts go into a shared preamble, which the build can
+    // precompile once for all of them (smokegen doesn't do that itself). A precompiled header has to come first, so
+    // these headers now precede the other #includes of a part instead of being sorted in among them. The order
+    // doesn't matter: every generated #include is a public header of the wrapped library, which has to compile on
+    // its own, and the sorting only keeps the output stable.
+    QSet<QString> preamble;
+    if (Options::unityBuild) {
+        for (QHash<QString, int>::const_iterator it = includeUsage.constBegin(); it != includeUsage.constEnd(); it++) {
+            if (it.value() * 2 >= filledParts)
+                preamble << it.key();
+        }
+
+        QFile file(Options::outputDir.filePath("x_preamble.h"));
+        file.open(QFile::ReadWrite | QFile::Truncate);
+
+        QTextStream fileOut(&file);
+        fileOut << "//Auto-generated by " << QCoreApplication::arguments()[0] << ". DO NOT EDIT.\n";
+        fileOut << "#ifndef SMOKE_" << Options::module.toUpper() << "_X_PREAMBLE_H\n";
+        fileOut << "#define SMOKE_" << Options::module.toUpper() << "_X_PREAMBLE_H\n\n";
+        writeIncludes(fileOut, preamble);
+        fileOut << "\n#include <smoke.h>\n#include <" << Options::module << "_smoke.h>\n";
+        fileOut << "\n#endif\n";
+
+        file.close();
+    }
+
+    for (int i = 0; i < Options::parts; i++) {
         // create the file
         QFile file(Options::outputDir.filePath("x_" + QString::number(i + 1) + ".cpp"));
         file.open(QFile::ReadWrite | QFile::Truncate);
@@ -70,15 +223,9 @@ void SmokeClassFiles::write(const QList<QString>& keys)
         fileOut << "//Auto-generated by " << QCoreApplication::arguments()[0] << ". DO NOT EDIT.\n";
 
         // ... and the #includes
-        QList<QString> sortedIncludes = includes.toList();
-        qSort(sortedIncludes.begin(), sortedIncludes.end());
-        for (QString& str : sortedIncludes) {
-            if (str.isEmpty())
-                continue;
-            if (str.startsWith("/builtins/"))
-                str.remove(0, 10);
-            fileOut << "#include <" << str << ">\n";
-        }
+        if (Options::unityBuild)
+            fileOut << "#include \"x_preamble.h\"\n";
+        writeIncludes(fileOut, partIncludes[i] - preamble);
 
         fileOut << "\n#include <smoke.h>\n#include <" << Options::module << "_smoke.h>\n";
 
@@ -87,14 +234,23 @@ void SmokeClassFiles::write(const QList<QString>& keys)
         fileOut << "\nnamespace __smoke" << Options::module << " {\n\n";
 
         // now the class code
-        fileOut << classCode;
-        
+        for (int j = boundaries[i]; j < boundaries[i + 1]; j++) {
+            fileOut << classCode[j];
+        }
+
         fileOut << "\n}\n";
         
         file.close();
     }
 }
 
+// whether the x_ class generated for 'klass' derives from __internal_SmokeClass, which marks objects created by the binding
+static bool derivesFromInternalClass(const Class* klass, bool privateDestructor)
+{
+    return !klass->isNameSpace() && !privateDestructor
+           && Util::hasClassVirtualDestructor(klass) && Util::hasClassPublicDestructor(klass);
+}
+
 QString SmokeClassFiles::generateMethodBody(const QString& indent, const QString& className, const QString& smokeClassName, const Method& meth,
                                             int index, bool dynamicDispatch, QSet<QString>& includes,
                                             bool privateDestructor)
@@ -171,7 +327,8 @@ QString SmokeClassFiles::generateMethodBody(const QString& indent, const QString
 
     out << ");\n";
     if (meth.type() != Type::Void) {
-        out << indent << "x[0]." << Util::stackItemField(meth.type()) << " = " << Util::assignmentString(meth.type(), "xret") << ";\n";
+        out << indent << "x[0]." << Util::stackItemField(meth.type()) << " = "
+            << Util::assignmentString(meth.type(), "xret", Options::returnBuffers ? "x[0].s_class" : QString()) << ";\n";
     } else {
         out << indent << "(void)x; // noop (for compiler warning)\n";
     }
@@ -200,7 +357,10 @@ void SmokeClassFiles::generateMethod(QTextStream& out, const QString& className,
     } else {
         // This is a virtual method. To know whether we should call with dynamic dispatch, we need a bit of RTTI magic.
         includes.insert("typeinfo");
-        out << "        if (dynamic_cast<__internal_SmokeClass*>(static_cast<" << className << "*>(this))) {\n";   //
+        if (derivesFromInternalClass(meth.getClass(), privateDestructor))
+            out << "        if (this->x_createdByBinding()) {\n";
+        else
+            out << "        if (dynamic_cast<__internal_SmokeClass*>(static_cast<" << className << "*>(this))) {\n";   //
         out << generateMethodBody("            ",   // indent
                                   className, smokeClassName, meth, index, false, includes, privateDestructor);
         out << "        } else {\n";
@@ -225,6 +385,59 @@ void SmokeClassFiles::generateMethod(QTextStream& out, const QString& className,
     }
 }
 
+// An overload added for default arguments fills in the missing arguments and calls the x_ method of the overload that
+// takes all of them, instead of repeating its body. Returns false without writing anything if a default value can't
+// be passed on the stack.
+bool SmokeClassFiles::generateDefaultArgumentCall(QTextStream& out, const QString& className, const Method& meth, int index,
+                                                  const Method& origin, int originIndex, bool privateDestructor)
+{
+    const QStringList& defaultValues = meth.remainingDefaultValues();
+    const int numArgs = meth.parameters().count();
+
+    QString defaultsCode;
+    QTextStream defaultsOut(&defaultsCode);
+    for (int i = 0; i < defaultValues.count(); i++) {
+        const Parameter& param = origin.parameters()[numArgs + i];
+        const int j = numArgs + i + 1;
+        Type resolved = param.type()->getTypedef() ? param.type()->getTypedef()->resolve() : *param.type();
+        if (resolved.isArray() || resolved.isFunctionPointer() || (resolved.isRef() && resolved.pointerDepth() > 0))
+            return false;
+
+        QString field = Util::stackItemField(param.type());
+        if (field == "s_class" && (resolved.pointerDepth() == 0 || resolved.isRef())) {
+            // passed by address; bind the value to a reference, so it lives until the call returns
+            Type refType = *param.type();
+            refType.setIsConst(true);
+            refType.setIsRef(true);
+            defaultsOut << "        " << refType.toString() << " xdef" << j << " = " << param.defaultValue() << ";\n";
+            defaultsOut << "        xargs[" << j << "].s_class = (void*)&xdef" << j << ";\n";
+        } else {
+            QString cast;
+            if (field == "s_class")
+                cast = "(void*)";
+            else if (field == "s_enum")
+                cast = "(long)";
+            else if (field == "s_uint" && !resolved.isIntegral())
+                cast = "(uint)";    // QFlags
+            defaultsOut << "        xargs[" << j << "]." << field << " = " << cast << '(' << defaultValues[i] << ");\n";
+        }
+    }
+
+    const bool passObj = !(meth.flags() & Method::Static) && privateDestructor;
+    out << "    ";
+    if ((meth.flags() & Method::Static) || meth.isConstructor() || privateDestructor)
+        out << "static ";
+    out << QString("void x_%1(%2Smoke::Stack x) {\n").arg(index).arg(passObj ? (className + "* obj, ") : "");
+    out << "        // " << meth.toString() << "\n";
+    out << "        Smoke::StackItem xargs[" << origin.parameters().count() + 1 << "];\n";
+    out << "        for (int xi = 0; xi <= " << numArgs << "; xi++) xargs[xi] = x[xi];\n";
+    out << defaultsCode;
+    out << "        x_" << originIndex << '(' << (passObj ? "obj, " : "") << "xargs);\n";
+    out << "        x[0] = xargs[0];\n";
+    out << "    }\n";
+    return true;
+}
+
 void SmokeClassFiles::generateGetAccessor(QTextStream& out, const QString& className, const Field& field,
                                           const Type* type, int index)
 {
@@ -239,7 +452,7 @@ void SmokeClassFiles::generateGetAccessor(QTextStream& out, const QString& class
     out << "void x_" << index << "(Smoke::Stack x) {\n"
         << "        // " << field.toString() << "\n"
         << "        x[0]." << Util::stackItemField(type) << " = "
-            << Util::assignmentString(type, fieldName) << ";\n"
+            << Util::assignmentString(type, fieldName, Options::returnBuffers ? "x[0].s_class" : QString()) << ";\n"
         << "    }\n";
 }
 
@@ -268,19 +481,23 @@ void SmokeClassFiles::generateSetAccessor(QTextStream& out, const QString& class
     out << "    }\n";
 }
 
-void SmokeClassFiles::generateEnumMemberCall(QTextStream& out, const QString& parentName, const QString& className, bool isScoped, const QString& member, int index)
+// the expression for the value of an enum member, as a long
+static QString enumMemberValue(const QString& parentName, const QString& className, bool isScoped, const QString& member)
 {
-    out << "    static void x_" << index << "(Smoke::Stack x) {\n"
-        << "        x[0].s_enum = (long)";
-    
+    QString value = "(long)";
     if (!parentName.isEmpty()) {
-        out << parentName << "::";
+        value += parentName + "::";
     }
     if (isScoped) {
-        out << className << "::";
+        value += className + "::";
     }
-    
-    out << member << ";\n"
+    return value + member;
+}
+
+void SmokeClassFiles::generateEnumMemberCall(QTextStream& out, const QString& value, int index)
+{
+    out << "    static void x_" << index << "(Smoke::Stack x) {\n"
+        << "        x[0].s_enum = " << value << ";\n"
         << "    }\n";
 }
 
@@ -315,8 +532,27 @@ void SmokeClassFiles::generateVirtualMethod(QTextStream& out, const Method& meth
         out << ") ";
     }
     out << "{\n";
+    if (!(meth.flags() & Method::PureVirtual)) {
+        // the binding told us it doesn't override this method, so don't bother calling it
+        int index = m_smokeData->methodIdx[&meth];
+        out << QString("        if (this->_overrides && !(this->_overrides[%1 / 8] & (1 << (%1 % 8))))\n").arg(index);
+        out << QString("            return this->%1::%2(%3);\n").arg(meth.getClass()->toString()).arg(meth.name()).arg(x_list);
+    }
     out << QString("        Smoke::StackItem x[%1];\n").arg(meth.parameters().count() + 1);
     out << x_params;
+
+    // classes returned by value can be constructed by the binding in a buffer on our stack
+    bool returnBuffer = Options::returnBuffers && meth.type()->pointerDepth() == 0 && !meth.type()->isRef()
+                        && Util::stackItemField(meth.type()) == "s_class";
+    QString deleteReturnValue = "delete xptr;";
+    if (returnBuffer) {
+        includes.insert("new");
+        includes.insert("type_traits");
+        out << "        typedef " << type << " xret_type;\n";
+        out << "        std::aligned_storage<sizeof(xret_type), alignof(xret_type)>::type xbuf;\n";
+        out << "        x[0].s_class = &xbuf;\n";
+        deleteReturnValue = "if (x[0].s_class == &xbuf) xptr->~xret_type(); else delete xptr;";
+    }
     
     if (meth.flags() & Method::PureVirtual) {
         out << QString("        this->_binding->callMethod(%1, (void*)this, x, true /*pure virtual*/);\n").arg(m_smokeData->methodIdx[&meth]);
@@ -328,7 +564,7 @@ void SmokeClassFiles::generateVirtualMethod(QTextStream& out, const Method& meth
                 tmpType.append('*');
                 out << "        " << tmpType << " xptr = (" << tmpType << ")x[0].s_class;\n";
                 out << "        " << type << " xret(*xptr);\n";
-                out << "        delete xptr;\n";
+                out << "        " << deleteReturnValue << "\n";
                 out << "        return xret;\n";
             } else {
                 out << QString("        return (%1)x[0].%2;\n").arg(type, Util::stackItemField(meth.type()));
@@ -347,7 +583,7 @@ void SmokeClassFiles::generateVirtualMethod(QTextStream& out, const Method& meth
                 out << "{\n";
                 out << "            " << tmpType << " xptr = (" << tmpType << ")x[0].s_class;\n";
                 out << "            " << type << " xret(*xptr);\n";
-                out << "            delete xptr;\n";
+                out << "            " << deleteReturnValue << "\n";
                 out << "            return xret;\n";
                 out << "        }\n";
             } else {
@@ -373,14 +609,19 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
     const QString underscoreName = QString(className).replace("::", "__");
     const QString smokeClassName = "x_" + underscoreName;
 
+    if (Options::returnBuffers)
+        includes.insert("new");
+
     QString switchCode;
     QTextStream switchOut(&switchCode);
+    // xcall index => statement, for the thunk table
+    QMap<int, QString> thunkCalls;
 
     out << QString("class %1").arg(smokeClassName);
     if (!klass->isNameSpace()) {
         if (!privateDestructor) {
             out << QString(" : public %1").arg(className);
-            if (Util::hasClassVirtualDestructor(klass) && Util::hasClassPublicDestructor(klass)) {
+            if (derivesFromInternalClass(klass, privateDestructor)) {
                 out << ", public __internal_SmokeClass";
             }
         }
@@ -388,18 +629,48 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
     out << " {\n";
     if (Util::canClassBeInstanciated(klass)) {
         out << "    SmokeBinding* _binding;\n";
+        out << "    const unsigned char* _overrides = 0;\n";
         out << "public:\n";
         out << "    void x_0(Smoke::Stack x) {\n";
         out << "        // set the smoke binding\n";
         out << "        _binding = (SmokeBinding*)x[1].s_class;\n";
         out << "    }\n";
+        out << "    void x_overrides(Smoke::Stack x) {\n";
+        out << "        // set the bit array of the virtual methods the binding overrides\n";
+        out << "        _overrides = (const unsigned char*)x[1].s_voidp;\n";
+        out << "    }\n";
         
         switchOut << "        case 0: xself->x_0(args);\tbreak;\n";
+        switchOut << "        case Smoke::sc_setOverrides: xself->x_overrides(args);\tbreak;\n";
+        thunkCalls[0] = "xself->x_0(args);";
     } else {
         out << "public:\n";
     }
+
+    if (derivesFromInternalClass(klass, privateDestructor) && !Util::virtualMethodsForClass(klass).isEmpty()) {
+        // Virtual methods are only called non-virtually on objects created by the binding. Comparing the exact type
+        // first answers the common cases without the cross-cast.
+        includes.insert("typeinfo");
+        out << "    bool x_createdByBinding() {\n";
+        out << "        const std::type_info& xtype = typeid(*static_cast<" << className << "*>(this));\n";
+        out << "        if (xtype == typeid(" << smokeClassName << "))\n";
+        out << "            return true;\n";
+        out << "        if (xtype == typeid(" << className << "))\n";
+        out << "            return false;\n";
+        out << "        return dynamic_cast<__internal_SmokeClass*>(static_cast<" << className << "*>(this)) != 0;\n";
+        out << "    }\n";
+    }
     
+    // xcall indices of the methods, so overloads for default arguments can call the method they were made from
+    QHash<const Method*, int> xcallIndices;
     int xcall_index = 1;
+    foreach (const Method& meth, klass->methods()) {
+        if (&meth == destructor || meth.access() == Access_private)
+            continue;
+        xcallIndices[&meth] = xcall_index++;
+    }
+
+    xcall_index = 1;
 
     foreach (const Method& meth, klass->methods()) {
         if (&meth == destructor)
@@ -414,10 +685,10 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
         else
             obj = "xself->";
 
-        switchOut << "        case " << xcall_index << ": "
-                  << obj
-                  << "x_" << xcall_index << QString("(%1args);\tbreak;\n")
-                     .arg((!(meth.flags() & Method::Static) && privateDestructor) ? "xself, " : "");
+        QString call = obj + "x_" + QString::number(xcall_index)
+                       + QString("(%1args);").arg((!(meth.flags() & Method::Static) && privateDestructor) ? "xself, " : "");
+        switchOut << "        case " << xcall_index << ": " << call << "\tbreak;\n";
+        thunkCalls[xcall_index] = call;
         if (Util::fieldAccessors.contains(&meth)) {
             // accessor method?
             const Field* field = Util::fieldAccessors[&meth];
@@ -427,7 +698,14 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
                 generateGetAccessor(out, className, *field, meth.type(), xcall_index);
             }
         } else {
-            generateMethod(out, className, smokeClassName, meth, xcall_index, includes, privateDestructor);
+            const Method* origin = meth.remainingDefaultValues().isEmpty() ? 0 : Util::defaultArgumentOrigin(meth);
+            // for a virtual origin, its x_ method also decides whether to call it virtually, just like the
+            // overload's call would in C++
+            if (!(origin && xcallIndices.contains(origin)
+                && generateDefaultArgumentCall(out, className, meth, xcall_index, *origin, xcallIndices[origin], privateDestructor)))
+            {
+                generateMethod(out, className, smokeClassName, meth, xcall_index, includes, privateDestructor);
+            }
         }
         xcall_index++;
     }
@@ -436,6 +714,9 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
     QTextStream enumOut(&enumCode);
     const Enum* e = 0;
     bool enumFound = false;
+    // the values of all enum members, which have consecutive xcall indices starting at firstEnumIndex
+    QStringList enumValues;
+    const int firstEnumIndex = xcall_index;
     for (const BasicTypeDeclaration* decl : klass->children()) {
         if (!(e = dynamic_cast<const Enum*>(decl)))
             continue;
@@ -443,11 +724,14 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
             continue;
         
         for (const EnumMember& member : e->members()) {
-            switchOut << "        case " << xcall_index << ": " << smokeClassName <<  "::x_" << xcall_index << "(args);\tbreak;\n";
-            if (e->parent())
-                generateEnumMemberCall(out, className, e->name(), e->isScoped(), member.name(), xcall_index++);
-            else
-                generateEnumMemberCall(out, e->nameSpace(), e->name(), e->isScoped(), member.name(), xcall_index++);
+            QString value = enumMemberValue(e->parent() ? className : e->nameSpace(), e->name(), e->isScoped(), member.name());
+            enumValues << value;
+            // the xcall function reads the values from xenum_values, only the thunk tables need a function per member
+            if (Options::thunkTables) {
+                thunkCalls[xcall_index] = smokeClassName + "::x_" + QString::number(xcall_index) + "(args);";
+                generateEnumMemberCall(out, value, xcall_index);
+            }
+            xcall_index++;
         }
         
         // only generate the xenum_call if the enum has a valid name
@@ -476,6 +760,9 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
         enumOut << "            break;\n";
     }
     
+    if (!enumValues.isEmpty())
+        out << "    static const long xenum_values[" << enumValues.count() << "];\n";
+    
     foreach (const Method* meth, Util::virtualMethodsForClass(klass)) {
         generateVirtualMethod(out, *meth, includes);
     }
@@ -505,6 +792,17 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
     }
     out << "};\n";
     
+    if (!enumValues.isEmpty()) {
+        out << "const long " << smokeClassName << "::xenum_values[" << enumValues.count() << "] = {\n";
+        foreach (const QString& value, enumValues) {
+            out << "    " << value << ",\n";
+        }
+        out << "};\n";
+        out << "extern const Smoke::EnumValues xenumvalues_" << underscoreName << ";\n";
+        out << "const Smoke::EnumValues xenumvalues_" << underscoreName << " = { "
+            << firstEnumIndex << ", " << enumValues.count() << ", " << smokeClassName << "::xenum_values };\n";
+    }
+    
     if (enumFound) {
         out << "void xenum_" << underscoreName << "(Smoke::EnumOperation xop, Smoke::Index xtype, void *&xdata, long &xvalue) {\n";
         out << "    " << smokeClassName << "::xenum_operation(xop, xtype, xdata, xvalue);\n";
@@ -517,12 +815,44 @@ void SmokeClassFiles::writeClass(QTextStream& out, const Class* klass, const QSt
         out << "    " << className << " *xself = (" << className << "*)obj;\n";
     else
         out << "    " << smokeClassName << " *xself = (" << smokeClassName << "*)obj;\n";
+    if (!enumValues.isEmpty()) {
+        out << "    if (xi >= " << firstEnumIndex << " && xi < " << firstEnumIndex + enumValues.count() << ") {\n";
+        out << "        args[0].s_enum = " << smokeClassName << "::xenum_values[xi - " << firstEnumIndex << "];\n";
+        out << "        return;\n";
+        out << "    }\n";
+    }
     out << "    switch(xi) {\n";
     out << switchCode;
-    if (Util::hasClassPublicDestructor(klass))
+    if (Util::hasClassPublicDestructor(klass)) {
         out << "        case " << xcall_index << ": delete (" << className << "*)xself;\tbreak;\n";
+        thunkCalls[xcall_index] = "delete (" + className + "*)xself;";
+    }
     out << "    }\n";
     out << "}\n";
+
+    if (!Options::thunkTables)
+        return;
+
+    // one function per xcall index, so bindings can call a method without going through the switch above
+    const QString selfType = privateDestructor ? className : smokeClassName;
+    for (QMap<int, QString>::const_iterator it = thunkCalls.constBegin(); it != thunkCalls.constEnd(); it++) {
+        out << "static void xthunk_" << underscoreName << '_' << it.key() << "(Smoke::Index, void *obj, Smoke::Stack args) {\n";
+        if (it.value().contains("xself"))
+            out << "    " << selfType << " *xself = (" << selfType << "*)obj;\n";
+        else
+            out << "    (void)obj;\n";
+        out << "    " << it.value() << "\n";
+        out << "}\n";
+    }
+    out << "extern const Smoke::ClassFn xthunks_" << underscoreName << "[];\n";
+    out << "const Smoke::ClassFn xthunks_" << underscoreName << "[] = {\n";
+    for (int i = 0; i <= xcall_index; i++) {
+        if (thunkCalls.contains(i))
+            out << "    xthunk_" << underscoreName << '_' << i << ",\n";
+        else
+            out << "    0,\n";
+    }
+    out << "};\n";
 }
 
 void SmokeClassFiles::addIncludesForType(QSet< QString >& includes, const Type* type) {
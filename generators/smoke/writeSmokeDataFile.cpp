@@ -24,8 +24,11 @@
 #include <QTextStream>
 
 #include <type.h>
+#include <smoke.h>
 
 #include "globals.h"
+#include "namehash.h"
+#include "smokemeta.h"
 #include "../../options.h"
 
 uint qHash(const QVector<int> intList)
@@ -182,36 +185,218 @@ QString SmokeDataFile::getTypeFlags(const Type *t, int *classIdx)
     return flags;
 }
 
+// numeric value of a flags string like "Smoke::mf_static|Smoke::mf_enum", as written to smokedata.cpp
+static quint32 flagsValue(const QString& flags)
+{
+    static QHash<QString, quint32> values;
+    if (values.isEmpty()) {
+        values["Smoke::cf_constructor"] = Smoke::cf_constructor;
+        values["Smoke::cf_deepcopy"] = Smoke::cf_deepcopy;
+        values["Smoke::cf_virtual"] = Smoke::cf_virtual;
+        values["Smoke::cf_namespace"] = Smoke::cf_namespace;
+        values["Smoke::cf_undefined"] = Smoke::cf_undefined;
+        values["Smoke::mf_static"] = Smoke::mf_static;
+        values["Smoke::mf_const"] = Smoke::mf_const;
+        values["Smoke::mf_copyctor"] = Smoke::mf_copyctor;
+        values["Smoke::mf_internal"] = Smoke::mf_internal;
+        values["Smoke::mf_enum"] = Smoke::mf_enum;
+        values["Smoke::mf_ctor"] = Smoke::mf_ctor;
+        values["Smoke::mf_dtor"] = Smoke::mf_dtor;
+        values["Smoke::mf_protected"] = Smoke::mf_protected;
+        values["Smoke::mf_attribute"] = Smoke::mf_attribute;
+        values["Smoke::mf_property"] = Smoke::mf_property;
+        values["Smoke::mf_virtual"] = Smoke::mf_virtual;
+        values["Smoke::mf_purevirtual"] = Smoke::mf_purevirtual;
+        values["Smoke::mf_signal"] = Smoke::mf_signal;
+        values["Smoke::mf_slot"] = Smoke::mf_slot;
+        values["Smoke::mf_explicit"] = Smoke::mf_explicit;
+        values["Smoke::t_voidp"] = Smoke::t_voidp;
+        values["Smoke::t_bool"] = Smoke::t_bool;
+        values["Smoke::t_char"] = Smoke::t_char;
+        values["Smoke::t_uchar"] = Smoke::t_uchar;
+        values["Smoke::t_short"] = Smoke::t_short;
+        values["Smoke::t_ushort"] = Smoke::t_ushort;
+        values["Smoke::t_int"] = Smoke::t_int;
+        values["Smoke::t_uint"] = Smoke::t_uint;
+        values["Smoke::t_long"] = Smoke::t_long;
+        values["Smoke::t_ulong"] = Smoke::t_ulong;
+        values["Smoke::t_float"] = Smoke::t_float;
+        values["Smoke::t_double"] = Smoke::t_double;
+        values["Smoke::t_enum"] = Smoke::t_enum;
+        values["Smoke::t_class"] = Smoke::t_class;
+        values["Smoke::tf_stack"] = Smoke::tf_stack;
+        values["Smoke::tf_ptr"] = Smoke::tf_ptr;
+        values["Smoke::tf_ref"] = Smoke::tf_ref;
+        values["Smoke::tf_const"] = Smoke::tf_const;
+    }
+
+    quint32 ret = 0;
+    foreach (const QString& flag, flags.split('|')) {
+        ret |= values.value(flag, 0);
+    }
+    return ret;
+}
+
+// whether a field can be read and written in place through a Smoke::Field descriptor
+static bool hasFieldDescriptor(const Class* klass, const Field& field)
+{
+    static QSet<QString> scalarNames;
+    if (scalarNames.isEmpty()) {
+        scalarNames << "bool" << "char" << "signed char" << "unsigned char"
+                    << "short" << "short int" << "unsigned short" << "unsigned short int"
+                    << "int" << "unsigned int" << "long" << "long int" << "unsigned long" << "unsigned long int"
+                    << "float" << "double";
+    }
+
+    if (field.access() != Access_public || (field.flags() & Member::BitField))
+        return false;
+    // taking the address of a member that has no definition outside of the class wouldn't link, its getter
+    // reads the value instead
+    if (field.flags() & Member::InClassInitializer)
+        return false;
+    // offsetof() is only guaranteed to work for standard layout classes
+    if (!(field.flags() & Member::Static) && (!klass->isStandardLayout() || klass->isNameSpace()))
+        return false;
+
+    Type type = *field.type();
+    if (type.getTypedef())
+        type = type.getTypedef()->resolve();
+    if (type.isRef() || type.isArray() || type.isFunctionPointer())
+        return false;
+    if (type.pointerDepth() > 0)
+        return true;
+    return type.isIntegral() && scalarNames.contains(type.name());
+}
+
+// name field of the classes and types tables; packed tables store the names in the string pool instead
+static QString nameField(const QString& name)
+{
+    return Options::packedTables ? QString("0") : '"' + name + '"';
+}
+
+static void writeIntArray(QTextStream& out, const QString& declaration, const std::vector<int>& values)
+{
+    out << declaration << " = {";
+    for (std::size_t i = 0; i < values.size(); i++) {
+        out << (i % 16 ? " " : "\n    ") << values[i] << ',';
+    }
+    out << "\n};\n\n";
+}
+
+// writes the tables of the perfect hash over 'names' and returns the initializer of its Smoke::NameHash
+static QString writeNameHash(QTextStream& out, const QString& name, const QList<QByteArray>& names)
+{
+    std::vector<const char*> nameData;
+    foreach (const QByteArray& entry, names)
+        nameData.push_back(entry.constData());
+    std::vector<int> displacements, indices;
+    if (names.isEmpty() || !buildNameHash(nameData, &displacements, &indices)) {
+        if (!names.isEmpty())
+            qWarning("couldn't build %s, lookups will use binary search", qPrintable(name));
+        return "{ 0, 0, 0 }";
+    }
+    writeIntArray(out, QString("static const int %1Displacements[]").arg(name), displacements);
+    writeIntArray(out, QString("static const Smoke::Index %1Indices[]").arg(name), indices);
+    return QString("{ %1, %2Displacements, %2Indices }").arg(names.count()).arg(name);
+}
+
+// collects the tables written to smokedata.cpp for the <module>.smokemeta file,
+// its string table is also used as the string pool of packed tables
+struct SmokeMetaTables
+{
+    SmokeMetaTables() : inheritanceList(1, 0), argumentList(1, 0) {
+        string(QString());
+    }
+
+    quint32 string(const QString& str) {
+        QByteArray latin1 = str.toLatin1();
+        QHash<QByteArray, quint32>::const_iterator it = stringOffsets.constFind(latin1);
+        if (it != stringOffsets.constEnd())
+            return *it;
+        quint32 offset = strings.size();
+        strings.append(latin1).append('\0');
+        stringOffsets[latin1] = offset;
+        return offset;
+    }
+
+    void write(const QString& fileName) {
+        SmokeMeta::Header header = { SmokeMeta::Magic, SmokeMeta::Version,
+                                     (quint32) classes.size(), (quint32) types.size(), (quint32) methods.size(),
+                                     (quint32) inheritanceList.size(), (quint32) argumentList.size(),
+                                     (quint32) parents.size(), (quint32) strings.size() };
+        QFile file(fileName);
+        file.open(QFile::WriteOnly | QFile::Truncate);
+        QDataStream stream(&file);
+        SmokeMeta::openStream(stream);
+        stream << header;
+        foreach (const SmokeMeta::Class& klass, classes)
+            stream << klass;
+        foreach (const SmokeMeta::Type& type, types)
+            stream << type;
+        foreach (const SmokeMeta::Method& method, methods)
+            stream << method;
+        foreach (qint32 index, inheritanceList)
+            stream << index;
+        foreach (qint32 index, argumentList)
+            stream << index;
+        foreach (quint32 parent, parents)
+            stream << parent;
+        stream.writeRawData(strings.constData(), strings.size());
+        file.close();
+    }
+
+    QVector<SmokeMeta::Class> classes;
+    QVector<SmokeMeta::Type> types;
+    QVector<SmokeMeta::Method> methods;
+    QVector<qint32> inheritanceList;
+    QVector<qint32> argumentList;
+    QVector<quint32> parents;   // names of the parent modules
+    QByteArray strings;
+    QHash<QByteArray, quint32> stringOffsets;
+};
+
 void SmokeDataFile::write()
 {
     qDebug("writing out smokedata.cpp [%s]", qPrintable(Options::module));
     QFile smokedata(Options::outputDir.filePath("smokedata.cpp"));
     smokedata.open(QFile::ReadWrite | QFile::Truncate);
-    QTextStream out(&smokedata);
+    QTextStream fileOut(&smokedata);
     QFile argNames(Options::outputDir.filePath(QString("%1.argnames.txt").arg(Options::module)));
     argNames.open(QFile::ReadWrite | QFile::Truncate);
     QTextStream outArgNames(&argNames);
     foreach (const QFileInfo& file, Options::headerList)
-        out << "#include <" << file.fileName() << ">\n";
-    out << "\n#include <smoke.h>\n";
-    out << "#include <" << Options::module << "_smoke.h>\n\n";
+        fileOut << "#include <" << file.fileName() << ">\n";
+    fileOut << "\n#include <smoke.h>\n";
+    fileOut << "#include <" << Options::module << "_smoke.h>\n\n";
     
+    // the index width is only known once the tables are written, so they're collected here and
+    // written after the entry types they're declared with
+    QString tables;
+    QTextStream out(&tables);
     QString smokeNamespaceName = "__smoke" + Options::module;
+    SmokeMetaTables meta;
     
     out << "namespace " << smokeNamespaceName  << " {\n\n";
     
-    // write out Options::module_cast() function
-    out << "static void *cast(void *xptr, Smoke::Index from, Smoke::Index to) {\n";
-    out << "  switch(from) {\n";
+    // write out the constant pointer adjustments, taken from the class layouts clang computed, and the
+    // Options::module_cast() function for the remaining casts, which need the virtual base table or go
+    // through classes whose layout isn't known
+    QStringList castOffsets;
+    QString castChecks;
+    QTextStream castCheckOut(&castChecks);
+    QString castCases;
+    QTextStream castOut(&castCases);
     for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
         const Class& klass = classes[iter.key()];
         if (klass.isNameSpace())
             continue;
         
+        QMap<int, QPair<long long, QString> > offsets;
+        QMap<int, QString> codeCasts;
+        QSet<int> downcasts;
         QSet<int> indices; // avoid duplicate case values (diamond-shaped inheritance)
+        indices << iter.value();
         
-        out << "    case " << iter.value() << ":   //" << iter.key() << "\n";
-        out << "      switch(to) {\n";
         foreach (const Class* base, Util::superClassList(&klass)) {
             QString className = base->toString();
             
@@ -221,11 +406,15 @@ void SmokeDataFile::write()
                     continue;
                 indices << index;
                 
-                out << QString("        case %1: return (void*)(%2*)(%3*)xptr;\n")
-                    .arg(index).arg(className).arg(klass.toString());
+                long long offset;
+                if (!Util::isVirtualInheritancePath(&klass, base) && Util::baseClassOffset(&klass, base, &offset)) {
+                    offsets[index] = qMakePair(offset, className);
+                } else {
+                    codeCasts[index] = QString("        case %1: return (void*)(%2*)(%3*)xptr;\n")
+                        .arg(index).arg(className).arg(klass.toString());
+                }
             }
         }
-        out << QString("        case %1: return (void*)(%2*)xptr;\n").arg(iter.value()).arg(klass.toString());
         foreach (const Class* desc, Util::descendantsList(&klass)) {
             QString className = desc->toString();
             
@@ -235,20 +424,78 @@ void SmokeDataFile::write()
                     continue;
                 indices << index;
                 
+                long long offset;
                 if (Util::isVirtualInheritancePath(desc, &klass)) {
-                    out << QString("        case %1: return (void*)dynamic_cast<%2*>((%3*)xptr);\n")
+                    codeCasts[index] = QString("        case %1: return (void*)dynamic_cast<%2*>((%3*)xptr);\n")
                         .arg(index).arg(className).arg(klass.toString());
+                } else if (Util::baseClassOffset(desc, &klass, &offset)) {
+                    offsets[index] = qMakePair(-offset, className);
+                    downcasts << index;
                 } else {
-                    out << QString("        case %1: return (void*)(%2*)(%3*)xptr;\n")
+                    codeCasts[index] = QString("        case %1: return (void*)(%2*)(%3*)xptr;\n")
                         .arg(index).arg(className).arg(klass.toString());
                 }
             }
         }
-        out << "        default: return xptr;\n";
-        out << "      }\n";
+        
+        for (QMap<int, QPair<long long, QString> >::const_iterator it = offsets.constBegin(); it != offsets.constEnd(); it++) {
+            castOffsets << QString("    { %1, %2, %3 },\t// %4 -> %5\n")
+                .arg(iter.value()).arg(it.key()).arg(it.value().first).arg(klass.toString()).arg(it.value().second);
+            // a downcast is checked through the opposite upcast, so the probe is only ever cast up
+            castCheckOut << "    checkCastOffset(" << castOffsets.count() << ", ";
+            if (downcasts.contains(it.key()))
+                castCheckOut << "probe - (char*)(" << klass.toString() << "*)(" << it.value().second << "*)probe);\n";
+            else
+                castCheckOut << "(char*)(" << it.value().second << "*)(" << klass.toString() << "*)probe - probe);\n";
+        }
+        
+        if (codeCasts.isEmpty())
+            continue;
+        castOut << "    case " << iter.value() << ":   //" << iter.key() << "\n";
+        castOut << "      switch(to) {\n";
+        foreach (const QString& codeCast, codeCasts) {
+            castOut << codeCast;
+        }
+        castOut << "        default: return xptr;\n";
+        castOut << "      }\n";
+    }
+    castOut.flush();
+    castCheckOut.flush();
+    
+    out << "// Pointer adjustments for casts between classes, sorted by from and to\n";
+    out << "// (from, to, offset)\n";
+    out << "static Smoke::CastOffset castOffsets[] = {\n";
+    out << "    { 0, 0, 0 },\t// (no class)\n";
+    foreach (const QString& castOffset, castOffsets) {
+        out << castOffset;
+    }
+    out << "};\n\n";
+    
+    // the offsets are only right for the ABI clang targeted when smokegen ran, so the module compares them
+    // with the casts of the compiler that builds it, once, and corrects those that differ
+    if (!castChecks.isEmpty()) {
+        out << "static void checkCastOffset(int i, std::ptrdiff_t offset) {\n";
+        out << "  if (castOffsets[i].offset != offset)\n";
+        out << "    castOffsets[i].offset = offset;\n";
+        out << "}\n\n";
+        out << "// only the pointer values are adjusted, no object is accessed\n";
+        out << "static void checkCastOffsets() {\n";
+        out << "    char *probe = reinterpret_cast<char*>(0x10000);\n";
+        out << castChecks;
+        out << "}\n\n";
+    }
+    
+    // casts that involve virtual inheritance or classes without a known layout
+    if (!castCases.isEmpty()) {
+        out << "static void *cast(void *xptr, Smoke::Index from, Smoke::Index to) {\n";
+        out << "  switch(from) {\n";
+        out << castCases;
+        out << "    default: return xptr;\n";
+        out << "  }\n";
+    } else {
+        out << "static void *cast(void *xptr, Smoke::Index, Smoke::Index) {\n";
+        out << "  return xptr;\n";
     }
-    out << "    default: return xptr;\n";
-    out << "  }\n";
     out << "}\n\n";
     
     // write out the inheritance list
@@ -256,7 +503,7 @@ void SmokeDataFile::write()
     QHash<const Class*, int> inheritanceIndex;
     out << "// Group of Indexes (0 separated) used as super class lists.\n";
     out << "// Classes with super classes have an index into this array.\n";
-    out << "static Smoke::Index inheritanceList[] = {\n";
+    out << "static IndexEntry inheritanceList[] = {\n";
     out << "    0,\t// 0: (no super class)\n";
     
     int currentIdx = 1;
@@ -284,8 +531,10 @@ void SmokeDataFile::write()
             for (int i = 0; i < indices.count(); i++) {
                 if (i > 0) out << ", ";
                 out << indices[i];
+                meta.inheritanceList << indices[i];
                 currentIdx++;
             }
+            meta.inheritanceList << 0;
             currentIdx++;
             out << ", 0,\t// " << idx << ": " << comment.join(", ") << "\n";
         } else {
@@ -340,25 +589,33 @@ void SmokeDataFile::write()
             continue;
         QString smokeClassName = QString(klass.toString()).replace("::", "__");
         out << "void xcall_" << smokeClassName << "(Smoke::Index, void*, Smoke::Stack);\n";
+        if (Options::thunkTables)
+            out << "extern const Smoke::ClassFn xthunks_" << smokeClassName << "[];\n";
+        if (Util::enumMemberCount(&klass))
+            out << "extern const Smoke::EnumValues xenumvalues_" << smokeClassName << ";\n";
     }
     
     // classes table
     out << "\n// List of all classes\n";
     out << "// Name, external, index into inheritanceList, method dispatcher, enum dispatcher, class flags, size\n";
-    out << "static Smoke::Class classes[] = {\n";
+    out << "static ClassEntry classes[] = {\n";
     out << "    { 0L, false, 0, 0, 0, 0, 0 },\t// 0 (no class)\n";
+    meta.classes.resize(classIndex.isEmpty() ? 1 : classIndex.last() + 1);
     int classCount = 0;
     for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
         if (!iter.value())
             continue;
         
         Class* klass = &classes[iter.key()];
+        SmokeMeta::Class& metaClass = meta.classes[iter.value()];
+        metaClass.name = meta.string(iter.key());
         
         if (externalClasses.contains(klass)) {
-            out << "    { \""  << iter.key() << "\", true, 0, 0, 0, 0, 0 },\t//" << iter.value() << "\n";
+            out << "    { " << nameField(iter.key()) << ", true, 0, 0, 0, 0, 0 },\t//" << iter.value() << " " << iter.key() << "\n";
+            metaClass.external = true;
         } else {
             QString smokeClassName = QString(iter.key()).replace("::", "__");
-            out << "    { \"" << iter.key() << "\", false" << ", "
+            out << "    { " << nameField(iter.key()) << ", false" << ", "
                 << inheritanceIndex.value(klass, 0) << ", xcall_" << smokeClassName << ", "
                 << (enumClassesHandled.contains(iter.key()) ? QString("xenum_").append(smokeClassName) : "0") << ", ";
             QString flags = "0";
@@ -371,11 +628,13 @@ void SmokeDataFile::write()
                 flags = "Smoke::cf_namespace";
             }
             out << flags << ", ";
+            metaClass.parents = inheritanceIndex.value(klass, 0);
+            metaClass.flags = flagsValue(flags);
             if (!klass->isNameSpace())
                 out << "sizeof(" << iter.key() << ")";
             else
                 out << '0';
-            out << " },\t//" << iter.value() << "\n";
+            out << " },\t//" << iter.value() << " " << iter.key() << "\n";
         }
         classCount = iter.value();
     }
@@ -383,8 +642,10 @@ void SmokeDataFile::write()
     
     out << "// List of all types needed by the methods (arguments and return values)\n"
         << "// Name, class ID if arg is a class, and TypeId\n";
-    out << "static Smoke::Type types[] = {\n";
+    out << "static TypeEntry types[] = {\n";
     out << "    { 0, 0, 0 },\t//0 (no type)\n";
+    SmokeMeta::Type noType = { 0, 0, 0 };
+    meta.types << noType;
     QMap<QString, Type*> sortedTypes;
     for (QSet<Type*>::const_iterator it = usedTypes.constBegin(); it != usedTypes.constEnd(); it++) {
         QString typeString = (*it)->toString();
@@ -393,6 +654,7 @@ void SmokeDataFile::write()
         }
     }
     
+    QList<QByteArray> typeNames;
     int i = 1;
     for (QMap<QString, Type*>::const_iterator it = sortedTypes.constBegin(); it != sortedTypes.constEnd(); it++) {
         Type* t = it.value();
@@ -402,7 +664,10 @@ void SmokeDataFile::write()
         int classIdx = 0;
         QString flags = getTypeFlags(t, &classIdx);
         typeIndex[t] = i;
-        out << "    { \"" << it.key() << "\", " << classIdx << ", " << flags << " },\t//" << i++ << "\n";
+        typeNames << it.key().toLatin1();
+        out << "    { " << nameField(it.key()) << ", " << classIdx << ", " << flags << " },\t//" << i++ << " " << it.key() << "\n";
+        SmokeMeta::Type metaType = { meta.string(it.key()), classIdx, flagsValue(flags) };
+        meta.types << metaType;
     }
     out << "};\n\n";
 
@@ -416,7 +681,7 @@ void SmokeDataFile::write()
     outTypeDefs.flush();
     typeDefsFile.close();
     
-    out << "static Smoke::Index argumentList[] = {\n";
+    out << "static IndexEntry argumentList[] = {\n";
     out << "    0,\t//0  (void)\n";
     
     QHash<QVector<int>, int> parameterList;
@@ -492,7 +757,9 @@ void SmokeDataFile::write()
                 for (int i = 0; i < indices.count(); i++) {
                     if (i > 0) out << ", ";
                     out << indices[i];
+                    meta.argumentList << indices[i];
                 }
+                meta.argumentList << 0;
                 out << ", 0,\t//" << idx << "  " << comment.join(", ") << "\n";
                 currentIdx += indices.count() + 1;
             }
@@ -514,19 +781,30 @@ void SmokeDataFile::write()
     out << "};\n\n";
     
     out << "// Raw list of all methods, using munged names\n";
-    out << "static const char *methodNames[] = {\n";
-    out << "    \"\",\t//0\n";
+    if (Options::packedTables) {
+        out << "static const unsigned int methodNameOffsets[] = {\n";
+        out << "    0,\t//0\n";
+    } else {
+        out << "static const char *methodNames[] = {\n";
+        out << "    \"\",\t//0\n";
+    }
     i = 1;
     for (QMap<QString, int>::iterator it = methodNames.begin(); it != methodNames.end(); it++, i++) {
         it.value() = i;
-        out << "    \"" << it.key() << "\",\t//" << i << "\n";
+        if (Options::packedTables) {
+            out << "    " << meta.string(it.key()) << ",\t//" << i << " " << it.key() << "\n";
+        } else {
+            out << "    \"" << it.key() << "\",\t//" << i << "\n";
+        }
     }
     out << "};\n\n";
     
     out << "// (classId, name (index in methodNames), argumentList index, number of args, method flags, "
         << "return type (index in types), xcall() index)\n";
-    out << "static Smoke::Method methods[] = {\n";
+    out << "static MethodEntry methods[] = {\n";
     out << "    { 0, 0, 0, 0, 0, 0, 0 },\t// (no method)\n";
+    SmokeMeta::Method noMethod = { 0, 0, 0, 0, 0, 0 };
+    meta.methods << noMethod;
     
     i = 1;
     int methodCount = 1;
@@ -599,6 +877,9 @@ void SmokeDataFile::write()
             } else {
                 out << ", " << typeIndex[meth.type()];
             }
+            SmokeMeta::Method metaMethod = { iter.value(), meta.string(meth.name()), numArgs ? parameterIndices[&meth] : 0,
+                                             numArgs, flagsValue(flags), typeIndex.value(meth.type(), 0) };
+            meta.methods << metaMethod;
             out << ", " << (isExternal ? 0 : xcall_index) << "},";
             
             // comment
@@ -647,6 +928,9 @@ void SmokeDataFile::write()
                     out << "    {" << iter.value() << ", " << methodNames[member.name()]
                         << ", 0, 0, Smoke::mf_static|Smoke::mf_enum, " << index
                         << ", " << xcall_index << "},";
+                    SmokeMeta::Method metaMethod = { iter.value(), meta.string(member.name()), 0, 0,
+                                                     Smoke::mf_static | Smoke::mf_enum, index };
+                    meta.methods << metaMethod;
                     
                     // comment
                     out << "\t//" << i << " " << klass->toString() << "::" << member.name() << " (enum)";
@@ -664,6 +948,9 @@ void SmokeDataFile::write()
                 out << "|Smoke::mf_protected";
             out << ", 0, " << xcall_index << " },\t//" << i << " " << klass->toString()
                 << "::" << destructor->name() << "()\n";
+            SmokeMeta::Method metaMethod = { iter.value(), meta.string(destructor->name()), 0, 0,
+                                             (quint32) (Smoke::mf_dtor | (destructor->access() == Access_private ? Smoke::mf_protected : 0)), 0 };
+            meta.methods << metaMethod;
             methodIdx[destructor] = i;
             xcall_index++;
             i++;
@@ -673,7 +960,7 @@ void SmokeDataFile::write()
     
     out << "};\n\n";
 
-    out << "static Smoke::Index ambiguousMethodList[] = {\n";
+    out << "static IndexEntry ambiguousMethodList[] = {\n";
     out << "    0,\n";
     
     QHash<const Class*, QHash<QString, int> > ambigiousIds;
@@ -712,12 +999,16 @@ void SmokeDataFile::write()
             i += munged_it.value().size() + 1;
         }
     }
+    const int ambiguousMethodCount = i;
 
     out << "};\n\n";
 
     int methodMapCount = 1;
+    // (class ID, munged name ID) of the entries, for the hot tables and the class ranges
+    QVector<QPair<int, int> > methodMapKeys;
+    methodMapKeys << qMakePair(0, 0);
     out << "// Class ID, munged name ID (index into methodNames), method def (see methods) if >0 or number of overloads if <0\n";
-    out << "static Smoke::MethodMap methodMaps[] = {\n";
+    out << "static MethodMapEntry methodMaps[] = {\n";
     out << "    {0, 0, 0},\t//0 (no method)\n";
 
     for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
@@ -742,12 +1033,227 @@ void SmokeDataFile::write()
             // comment
             out << "\t// " << klass->toString() << "::" << munged_it.key();
             out << "\n";
+            methodMapKeys << qMakePair(classIndex[iter.key()], methodNames[munged_it.key()]);
             methodMapCount++;
         }
     }
 
     out << "};\n\n";
 
+    out << "// Perfect hashes of the class, type and method names\n";
+    QList<QByteArray> classNames;
+    for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
+        classNames << iter.key().toLatin1();
+    }
+    QList<QByteArray> mungedNames;
+    for (QMap<QString, int>::const_iterator it = methodNames.constBegin(); it != methodNames.constEnd(); it++) {
+        mungedNames << it.key().toLatin1();
+    }
+    QString classHash = writeNameHash(out, "classHash", classNames);
+    QString typeHash = writeNameHash(out, "typeHash", typeNames);
+    QString methodNameHash = writeNameHash(out, "methodNameHash", mungedNames);
+
+    if (Options::packedTables) {
+        out << "// Offsets of the class and type names in the string pool\n";
+        out << "static const unsigned int classNameOffsets[] = {\n";
+        for (int j = 0; j < meta.classes.size(); j++) {
+            out << "    " << meta.classes[j].name << ",\t//" << j << "\n";
+        }
+        out << "};\n\n";
+        out << "static const unsigned int typeNameOffsets[] = {\n";
+        for (int j = 0; j < meta.types.size(); j++) {
+            out << "    " << meta.types[j].name << ",\t//" << j << "\n";
+        }
+        out << "};\n\n";
+
+        out << "// All class, type and method names, separated by \\0\n";
+        out << "static const char stringPool[] =\n";
+        int offset = 0;
+        foreach (const QByteArray& str, meta.strings.split('\0')) {
+            if (offset >= meta.strings.size())
+                break;
+            out << "    \"" << str << "\\0\"\t//" << offset << "\n";
+            offset += str.size() + 1;
+        }
+        out << "    ;\n\n";
+
+    }
+
+    if (Options::thunkTables) {
+        out << "// Thunk tables of the classes, indexed by class ID\n";
+        out << "static const Smoke::ClassFn *const classThunks[] = {\n";
+        out << "    0,\t//0 (no class)\n";
+        for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
+            Class& klass = classes[iter.key()];
+            if (externalClasses.contains(&klass) || klass.isTemplate())
+                out << "    0,\t//" << iter.value() << "\n";
+            else
+                out << "    xthunks_" << QString(iter.key()).replace("::", "__") << ",\t//" << iter.value() << "\n";
+        }
+        out << "};\n\n";
+    }
+
+    out << "// Enum values of the classes, indexed by class ID\n";
+    out << "static const Smoke::EnumValues *const classEnumValues[] = {\n";
+    out << "    0,\t//0 (no class)\n";
+    for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
+        Class& klass = classes[iter.key()];
+        if (externalClasses.contains(&klass) || klass.isTemplate() || !Util::enumMemberCount(&klass))
+            out << "    0,\t//" << iter.value() << "\n";
+        else
+            out << "    &xenumvalues_" << QString(iter.key()).replace("::", "__") << ",\t//" << iter.value() << "\n";
+    }
+    out << "};\n\n";
+
+    // the tables store 16 bit indexes, unless an index doesn't fit or -wide asks for 32 bits
+    const int largestIndex = qMax(qMax(qMax(classCount, methodCount), qMax(methodMapCount, methodNames.count())),
+                                  qMax(qMax(typeIndex.count(), meta.argumentList.size()),
+                                       qMax(meta.inheritanceList.size(), ambiguousMethodCount)));
+    if (largestIndex > 32767 && !Options::wideIndex) {
+        qWarning("%s has tables with %d entries, using 32 bit indexes", qPrintable(Options::module), largestIndex);
+        Options::wideIndex = true;
+    }
+    // the hot arrays and methodMapKeys hold 16 bit indexes
+    const bool hotColdTables = Options::hotColdTables && !Options::wideIndex;
+    if (Options::hotColdTables && Options::wideIndex)
+        qWarning("%s uses 32 bit indexes, not writing the tables of -hotcold", qPrintable(Options::module));
+
+    if (hotColdTables) {
+        // the SmokeMeta tables hold the same fields, with method names as offsets into the string pool
+        QHash<quint32, int> methodNameIds;
+        for (QMap<QString, int>::const_iterator it = methodNames.constBegin(); it != methodNames.constEnd(); it++) {
+            QHash<QByteArray, quint32>::const_iterator offset = meta.stringOffsets.constFind(it.key().toLatin1());
+            if (offset != meta.stringOffsets.constEnd())
+                methodNameIds[*offset] = it.value();
+        }
+
+        out << "// Parents, flags and external of the classes, indexed like classes\n";
+        out << "static const Smoke::HotClass hotClasses[] = {\n";
+        for (int j = 0; j < meta.classes.size(); j++) {
+            const SmokeMeta::Class& metaClass = meta.classes[j];
+            out << "    { " << metaClass.parents << ", " << metaClass.flags << ", " << (metaClass.external ? "true" : "false") << " },\t//" << j << "\n";
+        }
+        out << "};\n\n";
+
+        out << "// Class ID, name and flags of the methods, indexed like methods\n";
+        out << "static const Smoke::HotMethod hotMethods[] = {\n";
+        for (int j = 0; j < meta.methods.size(); j++) {
+            const SmokeMeta::Method& metaMethod = meta.methods[j];
+            out << "    { " << metaMethod.classId << ", " << (j ? methodNameIds.value(metaMethod.name) : 0) << ", " << metaMethod.flags << " },\t//" << j << "\n";
+        }
+        out << "};\n\n";
+
+        out << "// Class ID and munged name ID of the methodMaps, packed into sortable keys\n";
+        out << "static const Smoke::MethodMapKey methodMapKeys[] = {\n";
+        for (int j = 0; j < methodMapKeys.size(); j++) {
+            out << "    Smoke::methodMapKey(" << methodMapKeys[j].first << ", " << methodMapKeys[j].second << "),\t//" << j << "\n";
+        }
+        out << "};\n\n";
+    }
+
+    // methods and methodMaps are both grouped by ascending class ID, so the
+    // entries of a class form a contiguous range
+    QVector<int> classMethods(classCount + 2, 0), classMethodMaps(classCount + 2, 0);
+    for (int j = 1; j < meta.methods.size(); j++)
+        classMethods[meta.methods[j].classId + 1]++;
+    for (int j = 1; j < methodMapKeys.size(); j++)
+        classMethodMaps[methodMapKeys[j].first + 1]++;
+    classMethods[0] = classMethodMaps[0] = 1;
+    for (int j = 1; j < classCount + 2; j++) {
+        classMethods[j] += classMethods[j - 1];
+        classMethodMaps[j] += classMethodMaps[j - 1];
+    }
+
+    out << "// Start of the methodMaps entries of each class, the last entry ends the table\n";
+    out << "static const Smoke::Index classMethodMaps[] = {\n";
+    for (int j = 0; j < classMethodMaps.size(); j++)
+        out << "    " << classMethodMaps[j] << ",\t//" << j << "\n";
+    out << "};\n\n";
+
+    out << "// Start of the methods of each class, the last entry ends the table\n";
+    out << "static const Smoke::Index classMethods[] = {\n";
+    for (int j = 0; j < classMethods.size(); j++)
+        out << "    " << classMethods[j] << ",\t//" << j << "\n";
+    out << "};\n\n";
+
+    // getter and setter of the fields
+    QHash<const Field*, QPair<int, int> > fieldMethods;
+    for (QHash<const Method*, const Field*>::const_iterator it = Util::fieldAccessors.constBegin(); it != Util::fieldAccessors.constEnd(); it++) {
+        if (!methodIdx.contains(it.key()))
+            continue;
+        if (it.key()->type() == Type::Void)
+            fieldMethods[it.value()].second = methodIdx[it.key()];
+        else
+            fieldMethods[it.value()].first = methodIdx[it.key()];
+    }
+
+    int numFields = 0;
+    out << "// Fields that can be accessed in place, sorted by class ID\n";
+    out << "static const Smoke::Field fields[] = {\n";
+    out << "    { 0, 0, 0, 0, 0, 0, 0 },\t//0 (no field)\n";
+    for (QMap<QString, int>::const_iterator iter = classIndex.constBegin(); iter != classIndex.constEnd(); iter++) {
+        Class& klass = classes[iter.key()];
+        if (externalClasses.contains(&klass) || klass.isTemplate())
+            continue;
+        foreach (const Field& field, klass.fields()) {
+            if (!hasFieldDescriptor(&klass, field))
+                continue;
+            QPair<int, int> accessors = fieldMethods.value(&field);
+            if (!accessors.first)
+                continue;
+            int typeId = typeIndex.value(field.type(), 0);
+            if (!typeId)
+                continue;
+
+            QString flags = "0";
+            if (field.flags() & Member::Static)
+                flags += "|Smoke::ff_static";
+            if (!accessors.second)
+                flags += "|Smoke::ff_const";
+            flags.replace("0|", "");
+
+            out << "    { " << iter.value() << ", " << accessors.first << ", " << accessors.second << ", " << typeId << ", " << flags << ", ";
+            if (field.flags() & Member::Static)
+                out << "0, (void*)&" << klass.toString() << "::" << field.name();
+            else
+                out << "offsetof(" << klass.toString() << ", " << field.name() << "), 0";
+            out << " },\t//" << ++numFields << " " << klass.toString() << "::" << field.name() << "\n";
+        }
+    }
+    out << "};\n\n";
+
+    out << "static const Smoke::ExtraTables extraTables = {\n";
+    if (Options::packedTables)
+        out << "    stringPool, classNameOffsets, typeNameOffsets, methodNameOffsets,\n";
+    else
+        out << "    0, 0, 0, 0,\n";
+    out << "    " << classHash << ",\n";
+    out << "    " << typeHash << ",\n";
+    out << "    " << methodNameHash << ",\n";
+    out << "    castOffsets, " << castOffsets.count() + 1 << ",\n";
+    out << "    " << (Options::thunkTables ? "classThunks" : "0") << ",\n";
+    out << "    " << (Options::returnBuffers ? "true" : "false") << ",\n";
+    out << "    classEnumValues,\n";
+    out << "    fields, " << numFields + 1 << ",\n";
+    if (hotColdTables)
+        out << "    hotClasses, hotMethods, methodMapKeys,\n";
+    else
+        out << "    0, 0, 0,\n";
+    out << "    classMethodMaps, classMethods\n";
+    out << "};\n\n";
+
+    if (Options::wideIndex) {
+        out << "static const Smoke::WideTables wideTables = {\n";
+        out << "    classes,\n";
+        out << "    methods,\n";
+        out << "    methodMaps,\n";
+        out << "    types,\n";
+        out << "    inheritanceList,\n";
+        out << "    argumentList,\n";
+        out << "    ambiguousMethodList\n";
+        out << "};\n\n";
+    }
+
     out << "}\n\n";
 
     out << "extern \"C\" {\n\n";
@@ -759,29 +1265,59 @@ void SmokeDataFile::write()
     }
 
     out << "static bool initialized = false;\n";
-    out << "Smoke *" << Options::module << "_Smoke = 0;\n\n";
+    out << "Smoke *" << Options::module << "_Smoke = 0;\n";
+    out << "// size of the indexes in the tables, see Smoke::isSupportedIndexSize()\n";
+    out << "extern SMOKE_EXPORT const int " << Options::module << "_Smoke_indexSize;\n";
+    out << "const int " << Options::module << "_Smoke_indexSize = sizeof(" << smokeNamespaceName << "::IndexEntry);\n\n";
     out << "// Create the Smoke instance encapsulating all the above.\n";
     out << "void init_" << Options::module << "_Smoke() {\n";
     foreach (const QString& str, Options::parentModules) {
         out << "    init_" << str << "_Smoke();\n";
     }
     out << "    if (initialized) return;\n";
+    if (!castChecks.isEmpty())
+        out << "    " << smokeNamespaceName << "::checkCastOffsets();\n";
     out << "    " << Options::module << "_Smoke = new Smoke(\n";
     out << "        \"" << Options::module << "\",\n";
-    out << "        " << smokeNamespaceName << "::classes, " << classCount << ",\n";
-    out << "        " << smokeNamespaceName << "::methods, " << methodCount << ",\n";
-    out << "        " << smokeNamespaceName << "::methodMaps, " << methodMapCount << ",\n";
-    out << "        " << smokeNamespaceName << "::methodNames, " << methodNames.count() << ",\n";
-    out << "        " << smokeNamespaceName << "::types, " << typeIndex.count() << ",\n";
-    out << "        " << smokeNamespaceName << "::inheritanceList,\n";
-    out << "        " << smokeNamespaceName << "::argumentList,\n";
-    out << "        " << smokeNamespaceName << "::ambiguousMethodList,\n";
-    out << "        " << smokeNamespaceName << "::cast );\n";
+    const QString methodNamesArgument = Options::packedTables ? QString("0") : smokeNamespaceName + "::methodNames";
+    if (Options::wideIndex) {
+        out << "        &" << smokeNamespaceName << "::wideTables,\n";
+        out << "        " << classCount << ", " << methodCount << ", " << methodMapCount << ",\n";
+        out << "        " << methodNamesArgument << ", " << methodNames.count() << ",\n";
+        out << "        " << typeIndex.count() << ",\n";
+    } else {
+        out << "        " << smokeNamespaceName << "::classes, " << classCount << ",\n";
+        out << "        " << smokeNamespaceName << "::methods, " << methodCount << ",\n";
+        out << "        " << smokeNamespaceName << "::methodMaps, " << methodMapCount << ",\n";
+        out << "        " << methodNamesArgument << ", " << methodNames.count() << ",\n";
+        out << "        " << smokeNamespaceName << "::types, " << typeIndex.count() << ",\n";
+        out << "        " << smokeNamespaceName << "::inheritanceList,\n";
+        out << "        " << smokeNamespaceName << "::argumentList,\n";
+        out << "        " << smokeNamespaceName << "::ambiguousMethodList,\n";
+    }
+    out << "        " << smokeNamespaceName << "::cast,\n";
+    out << "        &" << smokeNamespaceName << "::extraTables );\n";
     out << "    initialized = true;\n";
     out << "}\n\n";
     out << "void delete_" << Options::module << "_Smoke() { delete " << Options::module << "_Smoke; }\n\n";
     out << "}\n";
+    out.flush();
+
+    // the entry types of the tables, with 16 or 32 bit indexes
+    const QString entryPrefix = Options::wideIndex ? "Smoke::Wide" : "Smoke::";
+    fileOut << "namespace " << smokeNamespaceName << " {\n\n";
+    fileOut << "using ClassEntry = " << entryPrefix << "Class;\n";
+    fileOut << "using MethodEntry = " << entryPrefix << "Method;\n";
+    fileOut << "using MethodMapEntry = " << entryPrefix << "MethodMap;\n";
+    fileOut << "using TypeEntry = " << entryPrefix << "Type;\n";
+    fileOut << "using IndexEntry = " << (Options::wideIndex ? "int" : "short") << ";\n\n";
+    fileOut << "}\n\n";
+    fileOut << tables;
 
     smokedata.close();
     argNames.close();
+
+    foreach (const QString& parent, Options::parentModules)
+        meta.parents << meta.string(parent);
+    meta.write(Options::outputDir.filePath(QString("%1.smokemeta").arg(Options::module)));
 }
@@ -1,10 +1,14 @@
 #ifndef SMOKE_H
 #define SMOKE_H
 
+#include <cassert>
 #include <cstddef>
 #include <cstring>
 #include <string>
 #include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 /*
    Copyright (C) 2002, Ashley Winters <qaqortog@nwlink.com>
@@ -69,6 +73,12 @@ class BASE_SMOKE_EXPORT Smoke {
 private:
     const char *module_name;
 
+    static void registerModule(Smoke *smoke);
+    static void unregisterModule(Smoke *smoke);
+
+    struct LookupCache;         // defined in smokebase.cpp
+    LookupCache *lookupCache;   // created by registerModule()
+
 public:
     union StackItem; // defined below
     /**
@@ -83,7 +93,12 @@ public:
 	EnumToLong
     };
 
-    using Index = short;
+    /**
+     * Indexes into the tables of a module. The tables store them as short,
+     * or as int in modules with more than 32767 classes, methods, types or
+     * arguments (see indexSize()), the API always passes them as Index.
+     */
+    using Index = int;
     using ClassFn = void (*)(Index, void *, Stack);
     using CastFn = void *(*)(void *, Index, Index);
     using EnumFn = void (*)(EnumOperation, Index, void *&, long &);
@@ -111,6 +126,14 @@ public:
     static ModuleIndex NullModuleIndex; 
     
     using ClassMap = std::map<std::string, ModuleIndex>;
+    /**
+     * Classes added by the bindings. The modules don't add their classes here
+     * anymore, they're found through the registry of loaded modules, see
+     * findClass(). To go through the classes of all modules, walk the
+     * non-external classes of each of loadedModules().
+     *
+     * @deprecated Only kept for the classes bindings add themselves.
+     */
     static ClassMap classMap;
 
     enum ClassFlags {
@@ -121,17 +144,38 @@ public:
         cf_undefined = 0x10     // defined elsewhere
     };
     /**
-     * Describe one class.
+     * Describe one class. The tables of a module hold Class entries, or
+     * WideClass entries if it has 32 bit indexes, and the same for Method,
+     * MethodMap and Type. Use classEntry() etc. to read either.
      */
-    struct Class {
-	const char *className;	// Name of the class
+    template <typename I>
+    struct BasicClass {
+	const char *className;	// Name of the class, 0 in packed modules (see ExtraTables), use Smoke::className()
 	bool external;		// Whether the class is in another module
-	Index parents;		// Index into inheritanceList
+	I parents;		// Index into inheritanceList
 	ClassFn classFn;	// Calls any method in the class
 	EnumFn enumFn;		// Handles enum pointers
         unsigned short flags;   // ClassFlags
         unsigned int size;
     };
+    using Class = BasicClass<short>;
+    using WideClass = BasicClass<int>;
+
+    /**
+     * Special method indexes for Class.classFn, besides 0, which sets the
+     * SmokeBinding of an object created by the binding (args[1].s_class).
+     *
+     * sc_setOverrides sets the virtual methods the binding overrides for an
+     * object: args[1].s_voidp points to a bit array indexed by method index
+     * (bit i % 8 of byte i / 8), which has to stay valid as long as the object
+     * lives. Virtual methods without their bit set call the C++ implementation
+     * directly instead of SmokeBinding::callMethod(). Pure virtual methods are
+     * always passed to the binding, and objects without a bit array (0, the
+     * default) pass all virtual calls to the binding.
+     */
+    enum SpecialCalls {
+        sc_setOverrides = -1
+    };
 
     enum MethodFlags {
         mf_static = 0x01,
@@ -153,15 +197,18 @@ public:
     /**
      * Describe one method of one class.
      */
-    struct Method {
-	Index classId;		// Index into classes
-	Index name;		// Index into methodNames; real name
-	Index args;		// Index into argumentList
+    template <typename I>
+    struct BasicMethod {
+	I classId;		// Index into classes
+	I name;			// Index into methodNames; real name
+	I args;			// Index into argumentList
 	unsigned char numArgs;	// Number of arguments
 	unsigned short flags;	// MethodFlags (const/static/etc...)
-	Index ret;		// Index into types for the return type
-	Index method;		// Passed to Class.classFn, to call method
+	I ret;			// Index into types for the return type
+	I method;		// Passed to Class.classFn, to call method
     };
+    using Method = BasicMethod<short>;
+    using WideMethod = BasicMethod<int>;
 
     /**
      * One MethodMap entry maps the munged method prototype
@@ -174,11 +221,14 @@ public:
      *
      * e.g. QApplication(int &, char **) becomes QApplication$?
      */
-    struct MethodMap {
-	Index classId;		// Index into classes
-	Index name;		// Index into methodNames; munged name
-	Index method;		// Index into methods
+    template <typename I>
+    struct BasicMethodMap {
+	I classId;		// Index into classes
+	I name;			// Index into methodNames; munged name
+	I method;		// Index into methods
     };
+    using MethodMap = BasicMethodMap<short>;
+    using WideMethodMap = BasicMethodMap<int>;
 
     enum TypeFlags {
         // The first 4 bits indicate the TypeId value, i.e. which field
@@ -196,11 +246,14 @@ public:
      * One Type entry is one argument type needed by a method.
      * Type entries are shared, there is only one entry for "int" etc.
      */
-    struct Type {
-	const char *name;	// Stringified type name
-	Index classId;		// Index into classes. -1 for none
+    template <typename I>
+    struct BasicType {
+	const char *name;	// Stringified type name, 0 in packed modules (see ExtraTables), use Smoke::typeName()
+	I classId;		// Index into classes. -1 for none
         unsigned short flags;   // TypeFlags
     };
+    using Type = BasicType<short>;
+    using WideType = BasicType<int>;
 
     // We could just pass everything around using void* (pass-by-reference)
     // I don't want to, though. -aw
@@ -238,9 +291,20 @@ public:
 	t_last		// number of pre-defined types
     };
 
+    /**
+     * The type of an argument a binding wants to pass, for resolveMethod().
+     */
+    struct ArgumentType {
+        TypeId typeId;          // t_class for objects, t_voidp for null or opaque pointers
+        ModuleIndex classId;    // Class of the object, for t_class
+        unsigned short flags;   // tf_const, if the object can't be modified
+    };
+
     // Passed to constructor
     /**
-     * The classes array defines every class for this module
+     * The classes array defines every class for this module. The tables
+     * from classes to ambiguousMethodList are 0 in modules with 32 bit
+     * indexes, which have wideTables instead.
      */
     Class *classes;
     Index numClasses;
@@ -259,7 +323,8 @@ public:
     Index numMethodMaps;
 
     /**
-     * Array of method names, for Method.name and MethodMap.name
+     * Array of method names, for Method.name and MethodMap.name. It is 0 in
+     * packed modules (see ExtraTables), use methodName() to get the names.
      */
     const char **methodNames;
     Index numMethodNames;
@@ -274,22 +339,157 @@ public:
      * Groups of Indexes (0 separated) used as super class lists.
      * For classes with super classes: Class.parents = index into this array.
      */
-    Index *inheritanceList;
+    short *inheritanceList;
     /**
      * Groups of type IDs (0 separated), describing the types of argument for a method.
      * Method.args = index into this array.
      */
-    Index *argumentList;
+    short *argumentList;
     /**
      * Groups of method prototypes with the same number of arguments, but different types.
      * Used to resolve overloading.
      */
-    Index *ambiguousMethodList;
+    short *ambiguousMethodList;
     /**
      * Function used for casting from/to the classes defined by this module.
      */
     CastFn castFn;
 
+    /**
+     * The tables of a module with 32 bit indexes.
+     */
+    struct WideTables {
+        WideClass *classes;
+        WideMethod *methods;
+        WideMethodMap *methodMaps;
+        WideType *types;
+        int *inheritanceList;
+        int *argumentList;
+        int *ambiguousMethodList;
+    };
+    /**
+     * The tables of a module with 32 bit indexes, 0 in other modules.
+     */
+    const WideTables *wideTables;
+
+    /**
+     * A perfect hash over the names of a table (hash and displace). The bucket
+     * of a name is hashName(name, 0) % size. A negative displacement d means the
+     * name is stored in slot -d - 1, otherwise in slot hashName(name, d) % size.
+     * The slots hold the index of the name in the table, which still has to be
+     * compared with the name that was looked up.
+     */
+    struct NameHash {
+        unsigned int size;
+        const int *displacements;
+        const Index *indices;
+    };
+
+    /**
+     * Constant pointer adjustment for casts between two classes of the module
+     * without virtual inheritance in between. Sorted by from and to; casts that
+     * are not listed are handled by castFn. Generated modules compare the offsets
+     * with their compiler's casts when they're created and correct them.
+     */
+    struct CastOffset {
+        Index from;
+        Index to;
+        std::ptrdiff_t offset;  // added to a 'from' pointer to get the 'to' pointer
+    };
+
+    /**
+     * The values of the enum members of a class. Their methods have consecutive
+     * Method.method indexes, starting at first.
+     */
+    struct EnumValues {
+        Index first;
+        Index count;
+        const long *values;
+    };
+
+    enum FieldFlags {
+        ff_static = 0x01,   // static member, Field.address is set
+        ff_const = 0x02     // read-only, there is no setter
+    };
+    /**
+     * Describes a public scalar or pointer field, so it can be read and written
+     * in place instead of calling its accessor methods. Only fields of standard
+     * layout classes are described, others are only reachable through the
+     * accessors. Sorted by classId.
+     */
+    struct Field {
+        Index classId;
+        Index getter;           // Index into methods
+        Index setter;           // Index into methods, 0 for const fields
+        Index type;             // Index into types
+        unsigned short flags;   // FieldFlags
+        std::size_t offset;     // offsetof() the field, for non-static fields
+        void *address;          // Address of static fields
+    };
+
+    /**
+     * The fields of Class and Method that scans and lookups read, in dense
+     * arrays indexed like classes and methods (smokegen -hotcold). Use the
+     * accessors like classFlags() and methodClassId(), they fall back to the
+     * full tables for modules without them. Only modules with 16 bit indexes
+     * have them.
+     */
+    struct HotClass {
+        short parents;
+        unsigned short flags;
+        bool external;
+    };
+    struct HotMethod {
+        short classId;
+        short name;
+        unsigned short flags;
+    };
+
+    /**
+     * MethodMap.classId and MethodMap.name packed into one sortable key, for
+     * modules with 16 bit indexes.
+     */
+    using MethodMapKey = unsigned int;
+    static inline MethodMapKey methodMapKey(Index classId, Index name) {
+        return (MethodMapKey) (unsigned short) classId << 16 | (unsigned short) name;
+    }
+
+    /**
+     * Additional tables generated along with the module.
+     *
+     * Modules generated with packed tables (smokegen -packed) store class, type
+     * and method names as offsets into stringPool instead of pointers, so the
+     * names need no relocations. Class::className, Type::name and methodNames
+     * are 0 in such modules, use className(), typeName() and methodName() to
+     * get the names. The tables themselves stay writable like in other modules.
+     */
+    struct ExtraTables {
+        const char *stringPool;
+        const unsigned int *classNames;     // Offsets into stringPool, indexed like classes
+        const unsigned int *typeNames;      // Offsets into stringPool, indexed like types
+        const unsigned int *methodNames;    // Offsets into stringPool, indexed like methodNames
+        NameHash classHash;
+        NameHash typeHash;
+        NameHash methodNameHash;
+        const CastOffset *castOffsets;
+        unsigned int numCastOffsets;
+        const ClassFn *const *classThunks;  // Per class, indexed by Method.method (smokegen -thunks)
+        bool returnBuffers;                 // See hasReturnBuffers() (smokegen -returnbuffers)
+        const EnumValues *const *classEnumValues;   // Per class, 0 for classes without enum members
+        const Field *fields;
+        unsigned int numFields;
+        const HotClass *hotClasses;
+        const HotMethod *hotMethods;
+        const MethodMapKey *methodMapKeys;  // Indexed like methodMaps
+        // The entries of class c are [classMethodMaps[c], classMethodMaps[c + 1]), same for classMethods
+        const Index *classMethodMaps;       // numClasses + 2 offsets into methodMaps
+        const Index *classMethods;          // numClasses + 2 offsets into methods
+    };
+    /**
+     * Additional tables or 0, if the module doesn't have any.
+     */
+    const ExtraTables *extraTables;
+
     /**
      * Constructor
      */
@@ -299,10 +499,11 @@ public:
 	  MethodMap *_methodMaps, Index _numMethodMaps,
 	  const char **_methodNames, Index _numMethodNames,
 	  Type *_types, Index _numTypes,
-	  Index *_inheritanceList,
-	  Index *_argumentList,
-	  Index *_ambiguousMethodList,
-	  CastFn _castFn) :
+	  short *_inheritanceList,
+	  short *_argumentList,
+	  short *_ambiguousMethodList,
+	  CastFn _castFn,
+	  const ExtraTables *_extraTables = 0) :
 		module_name(_moduleName),
 		classes(_classes), numClasses(_numClasses),
 		methods(_methods), numMethods(_numMethods),
@@ -312,15 +513,41 @@ public:
 		inheritanceList(_inheritanceList),
 		argumentList(_argumentList),
 		ambiguousMethodList(_ambiguousMethodList),
-		castFn(_castFn)
+		castFn(_castFn),
+		wideTables(0),
+		extraTables(_extraTables)
         {
-            for (Index i = 1; i <= numClasses; ++i) {
-                if (!classes[i].external) {
-                    classMap[className(i)] = ModuleIndex(this, i);
-                }
-            }
+            registerModule(this);
         }
 
+    /**
+     * Constructor of modules with 32 bit indexes
+     */
+    Smoke(const char *_moduleName,
+	  const WideTables *_wideTables,
+	  Index _numClasses, Index _numMethods, Index _numMethodMaps,
+	  const char **_methodNames, Index _numMethodNames,
+	  Index _numTypes,
+	  CastFn _castFn,
+	  const ExtraTables *_extraTables = 0) :
+		module_name(_moduleName),
+		classes(0), numClasses(_numClasses),
+		methods(0), numMethods(_numMethods),
+		methodMaps(0), numMethodMaps(_numMethodMaps),
+		methodNames(_methodNames), numMethodNames(_numMethodNames),
+		types(0), numTypes(_numTypes),
+		inheritanceList(0),
+		argumentList(0),
+		ambiguousMethodList(0),
+		castFn(_castFn),
+		wideTables(_wideTables),
+		extraTables(_extraTables)
+        {
+            registerModule(this);
+        }
+
+    ~Smoke();
+
     /**
      * Returns the name of the module (e.g. "qt" or "kde")
      */
@@ -328,27 +555,314 @@ public:
 	return module_name;
     }
 
+    /**
+     * The size of the indexes in the module's tables, 2 or 4 bytes.
+     */
+    inline int indexSize() const {
+        return wideTables ? sizeof(int) : sizeof(short);
+    }
+
+    /**
+     * Whether smokebase can load a module whose tables have 'indexSize'
+     * byte indexes. Modules export the size as <module>_Smoke_indexSize,
+     * pass the address of that symbol, or 0 for modules without it, before
+     * using <module>_Smoke.
+     */
+    static bool isSupportedIndexSize(const int *indexSize);
+
+    inline WideClass classEntry(Index classId) {
+        if (wideTables)
+            return wideTables->classes[classId];
+        const Class &c = classes[classId];
+        WideClass entry = { c.className, c.external, c.parents, c.classFn, c.enumFn, c.flags, c.size };
+        return entry;
+    }
+
+    inline WideMethod methodEntry(Index method) {
+        if (wideTables)
+            return wideTables->methods[method];
+        const Method &m = methods[method];
+        WideMethod entry = { m.classId, m.name, m.args, m.numArgs, m.flags, m.ret, m.method };
+        return entry;
+    }
+
+    inline WideMethodMap methodMapEntry(Index methodMap) {
+        if (wideTables)
+            return wideTables->methodMaps[methodMap];
+        const MethodMap &m = methodMaps[methodMap];
+        WideMethodMap entry = { m.classId, m.name, m.method };
+        return entry;
+    }
+
+    inline WideType typeEntry(Index typeId) {
+        if (wideTables)
+            return wideTables->types[typeId];
+        const Type &t = types[typeId];
+        WideType entry = { t.name, t.classId, t.flags };
+        return entry;
+    }
+
+    inline Index inheritanceListEntry(Index i) {
+        return wideTables ? wideTables->inheritanceList[i] : inheritanceList[i];
+    }
+
+    inline Index argumentListEntry(Index i) {
+        return wideTables ? wideTables->argumentList[i] : argumentList[i];
+    }
+
+    inline Index ambiguousMethodListEntry(Index i) {
+        return wideTables ? wideTables->ambiguousMethodList[i] : ambiguousMethodList[i];
+    }
+
     inline void *cast(void *ptr, const ModuleIndex& from, const ModuleIndex& to) {
         if (castFn == 0) {
             return ptr;
         }
         
         if (from.smoke == to.smoke) {
-            return (*castFn)(ptr, from.index, to.index);
+            return cast(ptr, from.index, to.index);
         }
         
-        const Smoke::Class &klass = to.smoke->classes[to.index];
-        return (*castFn)(ptr, from.index, idClass(klass.className, true).index);
+        return cast(ptr, from.index, idClass(to));
     }
     
     inline void *cast(void *ptr, Index from, Index to) {
+        if (extraTables && extraTables->numCastOffsets) {
+            const CastOffset *offset = castOffset(from, to);
+            if (offset)
+                return ptr ? static_cast<char *>(ptr) + offset->offset : 0;
+        }
     if(!castFn) return ptr;
     return (*castFn)(ptr, from, to);
     }
 
+    // returns the constant pointer adjustment for casts from 'from' to 'to', if there is one
+    inline const CastOffset *castOffset(Index from, Index to) {
+        const CastOffset *offsets = extraTables->castOffsets;
+        int imin = 0;
+        int imax = extraTables->numCastOffsets - 1;
+
+        while (imax >= imin) {
+            int icur = (imin + imax) / 2;
+            int icmp = leg(offsets[icur].from, from);
+            if (icmp == 0)
+                icmp = leg(offsets[icur].to, to);
+            if (icmp == 0)
+                return offsets + icur;
+
+            if (icmp > 0) {
+                imax = icur - 1;
+            } else {
+                imin = icur + 1;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * Returns the function that calls 'method' directly, without going through
+     * Class.classFn, or 0 if the module wasn't generated with thunk tables.
+     * It takes the same arguments as classFn, the method index is ignored.
+     */
+    inline ClassFn thunk(Index method) {
+        if (!extraTables || !extraTables->classThunks)
+            return 0;
+        const WideMethod meth = methodEntry(method);
+        const ClassFn *thunks = extraTables->classThunks[meth.classId];
+        return thunks ? thunks[meth.method] : 0;
+    }
+
+    /**
+     * Whether the module constructs classes returned by value in buffers
+     * provided by the binding, instead of allocating them with new.
+     *
+     * When calling a method, set args[0].s_class to a buffer of at least
+     * Class.size bytes, suitably aligned, or to 0 to get a new object as
+     * before. The result is returned in args[0].s_class either way.
+     *
+     * When a virtual method returning a class by value is passed to
+     * SmokeBinding::callMethod(), args[0].s_class points to such a buffer on
+     * the caller's stack. The binding can construct the result in it, or
+     * replace the pointer with an object allocated with new.
+     */
+    inline bool hasReturnBuffers() {
+        return extraTables && extraTables->returnBuffers;
+    }
+
+    /**
+     * Returns the value of an enum member (a method with mf_enum). It is read
+     * from the module's tables, if there are any, else it's got from classFn.
+     */
+    inline long enumValue(Index method) {
+        const WideMethod meth = methodEntry(method);
+        if (extraTables && extraTables->classEnumValues) {
+            const EnumValues *enums = extraTables->classEnumValues[meth.classId];
+            if (enums && meth.method >= enums->first && meth.method < enums->first + enums->count)
+                return enums->values[meth.method - enums->first];
+        }
+        StackItem x[1];
+        (*classEntry(meth.classId).classFn)(meth.method, 0, x);
+        return x[0].s_enum;
+    }
+
+    /**
+     * Returns the descriptor of the field accessed by 'method', a getter or
+     * setter, or 0 if the field can only be accessed by calling the method.
+     */
+    inline const Field *findField(Index method) {
+        if (!extraTables || !extraTables->numFields)
+            return 0;
+        const Field *fields = extraTables->fields;
+        Index classId = methodClassId(method);
+        int imin = 0;
+        int imax = extraTables->numFields;
+
+        // find the first field of the class
+        while (imin < imax) {
+            int icur = (imin + imax) / 2;
+            if (fields[icur].classId < classId) {
+                imin = icur + 1;
+            } else {
+                imax = icur;
+            }
+        }
+
+        for (unsigned int i = imin; i < extraTables->numFields && fields[i].classId == classId; ++i) {
+            if (fields[i].getter == method || fields[i].setter == method)
+                return fields + i;
+        }
+
+        return 0;
+    }
+
+    // 'obj' has to point to an instance of field.classId, it's ignored for static fields
+    inline void *fieldAddress(const Field &field, void *obj) {
+        if (field.flags & ff_static)
+            return field.address;
+        return static_cast<char *>(obj) + field.offset;
+    }
+
+    /**
+     * Reads a field into 'item', like calling its getter would into args[0].
+     */
+    inline void readField(const Field &field, void *obj, StackItem &item) {
+        void *p = fieldAddress(field, obj);
+        unsigned short flags = typeFlags(field.type);
+        if ((flags & tf_ref) == tf_ptr) {
+            item.s_voidp = *static_cast<void **>(p);
+            return;
+        }
+        loadStackItem(p, flags, item);
+    }
+
+    /**
+     * Writes 'item' to a field, like calling its setter with it as args[1].
+     * Does nothing for const fields.
+     */
+    inline void writeField(const Field &field, void *obj, const StackItem &item) {
+        if (field.flags & ff_const)
+            return;
+        void *p = fieldAddress(field, obj);
+        unsigned short flags = typeFlags(field.type);
+        if ((flags & tf_ref) == tf_ptr) {
+            *static_cast<void **>(p) = item.s_voidp;
+            return;
+        }
+        switch (flags & tf_elem) {
+        case t_bool: *static_cast<bool *>(p) = item.s_bool; break;
+        case t_char: *static_cast<signed char *>(p) = item.s_char; break;
+        case t_uchar: *static_cast<unsigned char *>(p) = item.s_uchar; break;
+        case t_short: *static_cast<short *>(p) = item.s_short; break;
+        case t_ushort: *static_cast<unsigned short *>(p) = item.s_ushort; break;
+        case t_int: *static_cast<int *>(p) = item.s_int; break;
+        case t_uint: *static_cast<unsigned int *>(p) = item.s_uint; break;
+        case t_long: *static_cast<long *>(p) = item.s_long; break;
+        case t_ulong: *static_cast<unsigned long *>(p) = item.s_ulong; break;
+        case t_float: *static_cast<float *>(p) = item.s_float; break;
+        case t_double: *static_cast<double *>(p) = item.s_double; break;
+        default: break;
+        }
+    }
+
+    inline unsigned short classFlags(Index classId) {
+        if (extraTables && extraTables->hotClasses)
+            return extraTables->hotClasses[classId].flags;
+        return wideTables ? wideTables->classes[classId].flags : classes[classId].flags;
+    }
+
+    // index into inheritanceList
+    inline Index classParents(Index classId) {
+        if (extraTables && extraTables->hotClasses)
+            return extraTables->hotClasses[classId].parents;
+        return wideTables ? wideTables->classes[classId].parents : classes[classId].parents;
+    }
+
+    inline bool isExternalClass(Index classId) {
+        if (extraTables && extraTables->hotClasses)
+            return extraTables->hotClasses[classId].external;
+        return wideTables ? wideTables->classes[classId].external : classes[classId].external;
+    }
+
+    inline Index methodClassId(Index method) {
+        if (extraTables && extraTables->hotMethods)
+            return extraTables->hotMethods[method].classId;
+        return wideTables ? wideTables->methods[method].classId : methods[method].classId;
+    }
+
+    // index into methodNames
+    inline Index methodNameId(Index method) {
+        if (extraTables && extraTables->hotMethods)
+            return extraTables->hotMethods[method].name;
+        return wideTables ? wideTables->methods[method].name : methods[method].name;
+    }
+
+    inline unsigned short methodFlags(Index method) {
+        if (extraTables && extraTables->hotMethods)
+            return extraTables->hotMethods[method].flags;
+        return wideTables ? wideTables->methods[method].flags : methods[method].flags;
+    }
+
+    inline unsigned short typeFlags(Index typeId) {
+        return wideTables ? wideTables->types[typeId].flags : types[typeId].flags;
+    }
+
     // return classname directly
     inline const char *className(Index classId) {
-	return classes[classId].className;
+        if (extraTables && extraTables->classNames)
+            return classId ? extraTables->stringPool + extraTables->classNames[classId] : 0;
+	return wideTables ? wideTables->classes[classId].className : classes[classId].className;
+    }
+
+    inline const char *typeName(Index typeId) {
+        if (extraTables && extraTables->typeNames)
+            return typeId ? extraTables->stringPool + extraTables->typeNames[typeId] : 0;
+        return wideTables ? wideTables->types[typeId].name : types[typeId].name;
+    }
+
+    inline const char *methodName(Index methodNameId) {
+        if (extraTables && extraTables->methodNames)
+            return extraTables->stringPool + extraTables->methodNames[methodNameId];
+        return methodNames[methodNameId];
+    }
+
+    /**
+     * Seeded FNV-1a hash used by the NameHash tables. The generator uses the same function.
+     */
+    static inline unsigned int hashName(const char *name, unsigned int seed) {
+        unsigned int h = 2166136261u ^ seed;
+        for (; *name; ++name) {
+            h ^= (unsigned char) *name;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // returns the only index that can have the name, or 0
+    static inline Index hashLookup(const NameHash &hash, const char *name) {
+        int d = hash.displacements[hashName(name, 0) % hash.size];
+        unsigned int slot = (d < 0) ? -d - 1 : hashName(name, d) % hash.size;
+        return hash.indices[slot];
     }
 
     inline int leg(Index a, Index b) {  // ala Perl's <=>
@@ -357,6 +871,11 @@ public:
     }
 
     inline Index idType(const char *t) {
+        if (extraTables && extraTables->typeHash.size) {
+            Index i = hashLookup(extraTables->typeHash, t);
+            return (i && strcmp(typeName(i), t) == 0) ? i : 0;
+        }
+
         Index imax = numTypes;
         Index imin = 1;
         Index icur = -1;
@@ -364,7 +883,7 @@ public:
 
         while (imax >= imin) {
             icur = (imin + imax) / 2;
-            icmp = strcmp(types[icur].name, t);
+            icmp = strcmp(typeName(icur), t);
             if (icmp == 0) {
                 return icur;
             }
@@ -380,6 +899,13 @@ public:
     }
 
     inline ModuleIndex idClass(const char *c, bool external = false) {
+        if (extraTables && extraTables->classHash.size) {
+            Index i = hashLookup(extraTables->classHash, c);
+            if (!i || strcmp(className(i), c) != 0 || (isExternalClass(i) && !external))
+                return NullModuleIndex;
+            return ModuleIndex(this, i);
+        }
+
         Index imax = numClasses;
         Index imin = 1;
         Index icur = -1;
@@ -387,9 +913,9 @@ public:
 
         while (imax >= imin) {
             icur = (imin + imax) / 2;
-            icmp = strcmp(classes[icur].className, c);
+            icmp = strcmp(className(icur), c);
             if (icmp == 0) {
-                if (classes[icur].external && !external) {
+                if (isExternalClass(icur) && !external) {
                     return NullModuleIndex;
                 } else {
                     return ModuleIndex(this, icur);
@@ -406,16 +932,33 @@ public:
         return NullModuleIndex;
     }
 
-    static inline ModuleIndex findClass(const char *c) {
-        ClassMap::iterator i = classMap.find(c);
-        if (i == classMap.end()) {
-            return NullModuleIndex;
-        } else {
-            return i->second;
-        }
-    }
+    /**
+     * Looks a class up in all loaded modules, in the order of loadedModules(),
+     * then in classMap. Safe to call while another thread loads a module.
+     */
+    static ModuleIndex findClass(const char *c);
+
+    /**
+     * Returns the loaded modules, the most recently loaded first, except that
+     * a module takes the place of a deleted one if there is one.
+     */
+    static std::vector<Smoke *> loadedModules();
+
+    /**
+     * Returns the ID of a class of another module in this module, where it's
+     * an external class, or 0 if this module doesn't know the class. The IDs
+     * are looked up by name once and kept in a table per module.
+     */
+    Index idClass(const ModuleIndex &foreignClass);
 
     inline ModuleIndex idMethodName(const char *m) {
+        if (extraTables && extraTables->methodNameHash.size) {
+            Index i = hashLookup(extraTables->methodNameHash, m);
+            if (!i || strcmp(methodName(i), m) != 0)
+                return NullModuleIndex;
+            return ModuleIndex(this, i);
+        }
+
         Index imax = numMethodNames;
         Index imin = 1;
         Index icur = -1;
@@ -423,7 +966,7 @@ public:
 
         while (imax >= imin) {
             icur = (imin + imax) / 2;
-            icmp = strcmp(methodNames[icur], m);
+            icmp = strcmp(methodName(icur), m);
             if (icmp == 0) {
                 return ModuleIndex(this, icur);
             }
@@ -446,18 +989,113 @@ public:
 	if (cmi.smoke && cmi.smoke != this) {
 	    return cmi.smoke->findMethodName(c, m);
 	} else if (cmi.smoke == this) {
-	    if (!classes[cmi.index].parents) return NullModuleIndex;
-	    for (Index p = classes[cmi.index].parents; inheritanceList[p]; p++) {
-		Index ci = inheritanceList[p];
+	    if (!classParents(cmi.index)) return NullModuleIndex;
+	    for (Index p = classParents(cmi.index); inheritanceListEntry(p); p++) {
+		Index ci = inheritanceListEntry(p);
 		const char* cName = className(ci);
-		ModuleIndex mi = classMap[cName].smoke->findMethodName(cName, m);
+		Smoke *parentModule = findClass(cName).smoke;
+		if (!parentModule) continue;
+		ModuleIndex mi = parentModule->findMethodName(cName, m);
 		if (mi.index) return mi;
 	    }
 	}
 	return NullModuleIndex;
     }
 
+    /**
+     * Sets [*first, *end) to the methodMaps entries of a class.
+     */
+    inline void methodMapRange(Index classId, Index *first, Index *end) {
+        if (extraTables && extraTables->classMethodMaps) {
+            *first = extraTables->classMethodMaps[classId];
+            *end = extraTables->classMethodMaps[classId + 1];
+            return;
+        }
+        // methodMaps is sorted by class
+        int imin = 1, imax = numMethodMaps;
+        while (imin < imax) {
+            int icur = (imin + imax) / 2;
+            if (methodMapEntry(icur).classId < classId) imin = icur + 1; else imax = icur;
+        }
+        *first = imin;
+        imax = numMethodMaps;
+        while (imin < imax) {
+            int icur = (imin + imax) / 2;
+            if (methodMapEntry(icur).classId <= classId) imin = icur + 1; else imax = icur;
+        }
+        *end = imin;
+    }
+
+    /**
+     * Sets [*first, *end) to the methods of a class, including its enum
+     * members and destructor.
+     */
+    inline void methodRange(Index classId, Index *first, Index *end) {
+        if (extraTables && extraTables->classMethods) {
+            *first = extraTables->classMethods[classId];
+            *end = extraTables->classMethods[classId + 1];
+            return;
+        }
+        // smokegen writes the methods grouped by class, in the order of the classes
+        int imin = 1, imax = numMethods;
+        while (imin < imax) {
+            int icur = (imin + imax) / 2;
+            if (methodClassId(icur) < classId) imin = icur + 1; else imax = icur;
+        }
+        *first = imin;
+        imax = numMethods;
+        while (imin < imax) {
+            int icur = (imin + imax) / 2;
+            if (methodClassId(icur) <= classId) imin = icur + 1; else imax = icur;
+        }
+        *end = imin;
+    }
+
     inline ModuleIndex idMethod(Index c, Index name) {
+        if (extraTables && extraTables->classMethodMaps) {
+            // only look at the entries of the class
+            Index first, end;
+            methodMapRange(c, &first, &end);
+            int imin = first;
+            int imax = end - 1;
+            const MethodMapKey *keys = extraTables->methodMapKeys;
+            const MethodMapKey key = methodMapKey(c, name);
+
+            while (imax >= imin) {
+                int icur = (imin + imax) / 2;
+                int icmp = keys ? (keys[icur] == key ? 0 : (keys[icur] > key ? 1 : -1)) : leg(methodMapEntry(icur).name, name);
+                if (icmp == 0)
+                    return ModuleIndex(this, icur);
+                if (icmp > 0) {
+                    imax = icur - 1;
+                } else {
+                    imin = icur + 1;
+                }
+            }
+
+            return NullModuleIndex;
+        }
+
+        if (extraTables && extraTables->methodMapKeys) {
+            const MethodMapKey *keys = extraTables->methodMapKeys;
+            const MethodMapKey key = methodMapKey(c, name);
+            int imin = 1;
+            int imax = numMethodMaps - 1;
+
+            while (imax >= imin) {
+                int icur = (imin + imax) / 2;
+                if (keys[icur] == key)
+                    return ModuleIndex(this, icur);
+                if (keys[icur] > key) {
+                    imax = icur - 1;
+                } else {
+                    imin = icur + 1;
+                }
+            }
+
+            return NullModuleIndex;
+        }
+
         Index imax = numMethodMaps;
         Index imin = 1;
         Index icur = -1;
@@ -465,9 +1103,10 @@ public:
 
         while (imax >= imin) {
             icur = (imin + imax) / 2;
-            icmp = leg(methodMaps[icur].classId, c);
+            const WideMethodMap map = methodMapEntry(icur);
+            icmp = leg(map.classId, c);
             if (icmp == 0) {
-                icmp = leg(methodMaps[icur].name, name);
+                icmp = leg(map.name, name);
                 if (icmp == 0) {
                     return ModuleIndex(this, icur);
                 }
@@ -483,27 +1122,26 @@ public:
         return NullModuleIndex;
     }
 
-    inline ModuleIndex findMethod(ModuleIndex c, ModuleIndex name) {
-        if (!c.index || !name.index) {
-            return NullModuleIndex;
-        } else if (name.smoke == this && c.smoke == this) {
-            ModuleIndex mi = idMethod(c.index, name.index);
-            if (mi.index) return mi;
-        } else if (c.smoke != this) {
-            return c.smoke->findMethod(c, name);
-        }
+    /**
+     * Looks up the MethodMap entry of the munged method name 'name' in class
+     * 'c' or its base classes, in the order of their declaration (depth first).
+     * Found entries are cached per module.
+     */
+    ModuleIndex findMethod(ModuleIndex c, ModuleIndex name);
 
-        for (Index *i = inheritanceList + classes[c.index].parents; *i; ++i) {
-            const char *cName = className(*i);
-            ModuleIndex ci = findClass(cName);
-            if (!ci.smoke)
-                return NullModuleIndex;
-            ModuleIndex ni = ci.smoke->findMethodName(cName, name.smoke->methodNames[name.index]);
-            ModuleIndex mi = ci.smoke->findMethod(ci, ni);
-            if (mi.index) return mi;
-        }
-        return NullModuleIndex;
-    }
+    /**
+     * Picks the method of the MethodMap entry 'methodMap' that takes the
+     * given arguments, preferring exact matches over conversions and derived
+     * classes. Returns the method index, or 0 if no method takes the arguments.
+     * Of equally good methods the first one in ambiguousMethodList is
+     * returned, ambiguous calls aren't reported; a binding that wants to reject
+     * them has to compare the candidates itself.
+     *
+     * Decisions are cached per module, keyed by the entry and the argument
+     * types, so they're made once per call site. Calls with more than 6
+     * arguments aren't cached.
+     */
+    Index resolveMethod(Index methodMap, const ArgumentType *args, int numArgs);
 
     inline ModuleIndex findMethod(const char *c, const char *name) {
         ModuleIndex idc = idClass(c);
@@ -517,32 +1155,307 @@ public:
         return isDerivedFrom(classId.smoke, classId.index, baseClassId.smoke, baseClassId.index);
     }
     
-    static inline bool isDerivedFrom(Smoke *smoke, Index classId, Smoke *baseSmoke, Index baseId) {
-	if (!classId || !baseId || !smoke || !baseSmoke)
-	    return false;
-	if (smoke == baseSmoke && classId == baseId)
-	    return true;
-	
-	for(Index p = smoke->classes[classId].parents; smoke->inheritanceList[p]; p++) {
-	    Class& cur = smoke->classes[smoke->inheritanceList[p]];
-	    if (cur.external) {
-		ModuleIndex mi = findClass(cur.className);
-		if (isDerivedFrom(mi.smoke, mi.index, baseSmoke, baseId))
-		    return true;
-	    }
-	    if (isDerivedFrom(smoke, smoke->inheritanceList[p], baseSmoke, baseId))
-		return true;
-	}
-	return false;
-    }
+    /**
+     * Whether a class is baseId or derives from it. Looks at a table of all
+     * base classes, which is built for each class when it's first needed.
+     */
+    static bool isDerivedFrom(Smoke *smoke, Index classId, Smoke *baseSmoke, Index baseId);
 
     static inline bool isDerivedFrom(const char *className, const char *baseClassName) {
     ModuleIndex classId = findClass(className);
     ModuleIndex baseId = findClass(baseClassName);
     return isDerivedFrom(classId.smoke, classId.index, baseId.smoke, baseId.index);
     }
+
+    /**
+     * Calls 'method' on 'obj' (0 for constructors and static methods) and
+     * returns its result as R, e.g.
+     *
+     *   int n = Smoke::call<int>(method, obj, 1.5, "name", someObject);
+     *
+     * The arguments are packed into a stack on the C++ stack, following the
+     * types in argumentList: numbers, bools and enums are converted to the
+     * parameter type, const references to numbers get a converted copy,
+     * pointers are passed as they are and objects by address. Pass the
+     * address of a variable for non-const references to numbers.
+     *
+     * Numbers are converted to R as well. Constructors return the new object,
+     * as R*. Objects the method returns by value are moved into R and then
+     * destroyed, objects returned by reference or pointer are copied.
+     *
+     * The number of arguments is checked against Method.numArgs with
+     * assert(). An argument or R that doesn't fit the method aborts.
+     */
+    template <typename R, typename... Args>
+    static R call(const ModuleIndex &method, void *obj, Args&&... args);
+
+    /**
+     * Reads the value of the type described by 'flags' (a Type.flags value)
+     * at 'p' into the matching member of 'item'. Values of other types,
+     * like objects, are passed by address.
+     */
+    static inline void loadStackItem(const void *p, unsigned short flags, StackItem &item) {
+        switch (flags & tf_elem) {
+        case t_bool: item.s_bool = *static_cast<const bool *>(p); break;
+        case t_char: item.s_char = *static_cast<const signed char *>(p); break;
+        case t_uchar: item.s_uchar = *static_cast<const unsigned char *>(p); break;
+        case t_short: item.s_short = *static_cast<const short *>(p); break;
+        case t_ushort: item.s_ushort = *static_cast<const unsigned short *>(p); break;
+        case t_int: item.s_int = *static_cast<const int *>(p); break;
+        case t_uint: item.s_uint = *static_cast<const unsigned int *>(p); break;
+        case t_long: item.s_long = *static_cast<const long *>(p); break;
+        case t_ulong: item.s_ulong = *static_cast<const unsigned long *>(p); break;
+        case t_float: item.s_float = *static_cast<const float *>(p); break;
+        case t_double: item.s_double = *static_cast<const double *>(p); break;
+        default: item.s_voidp = const_cast<void *>(p); break;
+        }
+    }
+
+private:
+    // reports an argument (0 for the return value) of call() that doesn't fit the method and aborts
+    [[noreturn]] static void callMismatch(const ModuleIndex &method, int argument);
+};
+
+/**
+ * Converts between C++ numbers and the stack items of number, bool and enum
+ * types, for Smoke::call(). 'flags' is the Type.flags value of the type.
+ */
+struct SmokeNumber {
+    static bool isNumber(unsigned short flags) {
+        unsigned short id = flags & Smoke::tf_elem;
+        return id != Smoke::t_voidp && id != Smoke::t_class && id < Smoke::t_last;
+    }
+
+    template <typename T>
+    static void write(Smoke::StackItem &item, unsigned short flags, T value) {
+        switch (flags & Smoke::tf_elem) {
+        case Smoke::t_bool: item.s_bool = static_cast<bool>(value); break;
+        case Smoke::t_char: item.s_char = static_cast<signed char>(value); break;
+        case Smoke::t_uchar: item.s_uchar = static_cast<unsigned char>(value); break;
+        case Smoke::t_short: item.s_short = static_cast<short>(value); break;
+        case Smoke::t_ushort: item.s_ushort = static_cast<unsigned short>(value); break;
+        case Smoke::t_int: item.s_int = static_cast<int>(value); break;
+        case Smoke::t_uint: item.s_uint = static_cast<unsigned int>(value); break;
+        case Smoke::t_long: item.s_long = static_cast<long>(value); break;
+        case Smoke::t_ulong: item.s_ulong = static_cast<unsigned long>(value); break;
+        case Smoke::t_float: item.s_float = static_cast<float>(value); break;
+        case Smoke::t_double: item.s_double = static_cast<double>(value); break;
+        case Smoke::t_enum: item.s_enum = static_cast<long>(value); break;
+        default: break;
+        }
+    }
+
+    template <typename T>
+    static T read(const Smoke::StackItem &item, unsigned short flags) {
+        switch (flags & Smoke::tf_elem) {
+        case Smoke::t_bool: return static_cast<T>(item.s_bool);
+        case Smoke::t_char: return static_cast<T>(item.s_char);
+        case Smoke::t_uchar: return static_cast<T>(item.s_uchar);
+        case Smoke::t_short: return static_cast<T>(item.s_short);
+        case Smoke::t_ushort: return static_cast<T>(item.s_ushort);
+        case Smoke::t_int: return static_cast<T>(item.s_int);
+        case Smoke::t_uint: return static_cast<T>(item.s_uint);
+        case Smoke::t_long: return static_cast<T>(item.s_long);
+        case Smoke::t_ulong: return static_cast<T>(item.s_ulong);
+        case Smoke::t_float: return static_cast<T>(item.s_float);
+        case Smoke::t_double: return static_cast<T>(item.s_double);
+        case Smoke::t_enum: return static_cast<T>(item.s_enum);
+        default: return T();
+        }
+    }
+
+    // passes a number to a parameter of type 'flags'; 'storage' holds the copy for const references
+    template <typename T>
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &storage, unsigned short flags, T value) {
+        if (!isNumber(flags))
+            return false;
+        switch (flags & Smoke::tf_ref) {
+        case Smoke::tf_stack:
+            write(item, flags, value);
+            return true;
+        case Smoke::tf_ref:
+            // the size of enums isn't known, and changes to a non-const reference would be lost
+            if (!(flags & Smoke::tf_const) || (flags & Smoke::tf_elem) == Smoke::t_enum)
+                return false;
+            write(storage, flags, value);
+            item.s_voidp = &storage;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // whether a number can be read from a result of type 'flags'
+    static bool fits(unsigned short flags) {
+        if (!isNumber(flags))
+            return false;
+        return (flags & Smoke::tf_ref) == Smoke::tf_stack
+               || ((flags & Smoke::tf_ref) == Smoke::tf_ref && (flags & Smoke::tf_elem) != Smoke::t_enum);
+    }
+
+    template <typename T>
+    static T get(const Smoke::StackItem &item, unsigned short flags) {
+        if ((flags & Smoke::tf_ref) == Smoke::tf_stack)
+            return read<T>(item, flags);
+        Smoke::StackItem value;
+        Smoke::loadStackItem(item.s_voidp, flags, value);
+        return read<T>(value, flags);
+    }
+};
+
+/**
+ * Packs a C++ value of type T into a Smoke::StackItem for a parameter of a
+ * given type (a Type.flags value) and unpacks results, for Smoke::call().
+ * set() returns false if the value doesn't fit the parameter. Types without
+ * a specialization can't be passed.
+ */
+template <typename T, typename Enable = void>
+struct SmokeStackItem;
+
+template <typename T>
+struct SmokeStackItem<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &storage, unsigned short flags, T value) {
+        return SmokeNumber::set(item, storage, flags, value);
+    }
+    static bool fits(unsigned short flags) { return SmokeNumber::fits(flags); }
+    static T get(const Smoke::StackItem &item, unsigned short flags) { return SmokeNumber::get<T>(item, flags); }
+};
+
+template <typename T>
+struct SmokeStackItem<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &storage, unsigned short flags, T value) {
+        return SmokeNumber::set(item, storage, flags, static_cast<long>(value));
+    }
+    static bool fits(unsigned short flags) { return SmokeNumber::fits(flags); }
+    static T get(const Smoke::StackItem &item, unsigned short flags) { return static_cast<T>(SmokeNumber::get<long>(item, flags)); }
+};
+
+// pointers fit pointer and reference parameters, and objects passed by value
+template <typename T>
+struct SmokeStackItem<T *> {
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &, unsigned short flags, T *value) {
+        if (!fits(flags))
+            return false;
+        item.s_voidp = const_cast<void *>(static_cast<const void *>(value));
+        return true;
+    }
+    static bool fits(unsigned short flags) {
+        return flags && ((flags & Smoke::tf_ref) != Smoke::tf_stack || !SmokeNumber::isNumber(flags));
+    }
+    static T *get(const Smoke::StackItem &item, unsigned short) { return static_cast<T *>(item.s_voidp); }
+};
+
+template <>
+struct SmokeStackItem<std::nullptr_t> {
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &storage, unsigned short flags, std::nullptr_t) {
+        return SmokeStackItem<void *>::set(item, storage, flags, 0);
+    }
+};
+
+// objects are passed by address, whether the method takes them by value or by reference
+template <typename T>
+struct SmokeStackItem<T, typename std::enable_if<std::is_class<T>::value>::type> {
+    static bool set(Smoke::StackItem &item, Smoke::StackItem &, unsigned short flags, const T &value) {
+        if (SmokeNumber::isNumber(flags) || (flags & Smoke::tf_ref) == Smoke::tf_ptr)
+            return false;
+        item.s_class = const_cast<T *>(&value);
+        return true;
+    }
+};
+
+/**
+ * Unpacks the result of a method from args[0], for Smoke::call(). 'flags'
+ * is the Type.flags value of the return type, 0 for void.
+ */
+template <typename R, typename Enable = void>
+struct SmokeReturnValue {
+    SmokeReturnValue(Smoke *, Smoke::StackItem &, unsigned short) {}
+    static bool fits(unsigned short flags) { return SmokeStackItem<R>::fits(flags); }
+    R take(const Smoke::StackItem &item, unsigned short flags) { return SmokeStackItem<R>::get(item, flags); }
+};
+
+// objects returned by value would leak, their type isn't known here
+template <>
+struct SmokeReturnValue<void> {
+    SmokeReturnValue(Smoke *, Smoke::StackItem &, unsigned short) {}
+    static bool fits(unsigned short flags) {
+        return (flags & Smoke::tf_ref) != Smoke::tf_stack || (flags & Smoke::tf_elem) != Smoke::t_class;
+    }
+    void take(const Smoke::StackItem &, unsigned short) {}
+};
+
+template <typename T>
+struct SmokeReturnValue<T &> {
+    SmokeReturnValue(Smoke *, Smoke::StackItem &, unsigned short) {}
+    static bool fits(unsigned short flags) {
+        return (flags & Smoke::tf_ref) == Smoke::tf_ref || (flags & Smoke::tf_ref) == Smoke::tf_ptr;
+    }
+    T &take(const Smoke::StackItem &item, unsigned short) { return *static_cast<T *>(item.s_class); }
 };
 
+template <typename R>
+struct SmokeReturnValue<R, typename std::enable_if<std::is_class<R>::value>::type> {
+    typename std::aligned_storage<sizeof(R), alignof(R)>::type buffer;
+
+    SmokeReturnValue(Smoke *smoke, Smoke::StackItem &item, unsigned short flags) {
+        // construct the result in place if the module supports it, else it's allocated with new
+        if (owned(flags) && smoke->hasReturnBuffers())
+            item.s_class = &buffer;
+    }
+
+    static bool fits(unsigned short flags) {
+        return flags && !SmokeNumber::isNumber(flags);
+    }
+
+    // only objects returned by value belong to the caller, others are copied
+    static bool owned(unsigned short flags) {
+        return (flags & Smoke::tf_ref) == Smoke::tf_stack;
+    }
+
+    R take(const Smoke::StackItem &item, unsigned short flags) {
+        R *p = static_cast<R *>(item.s_class);
+        if (!owned(flags))
+            return R(*p);
+        R result(std::move(*p));
+        if (p == static_cast<void *>(&buffer))
+            p->~R();
+        else
+            delete p;
+        return result;
+    }
+};
+
+template <typename R, typename... Args>
+R Smoke::call(const ModuleIndex &method, void *obj, Args&&... args)
+{
+    Smoke *smoke = method.smoke;
+    const WideMethod meth = smoke->methodEntry(method.index);
+    assert(method.index > 0 && meth.numArgs == sizeof...(Args));
+
+    StackItem x[sizeof...(Args) + 1];
+    StackItem storage[sizeof...(Args) + 1];     // converted copies for const references
+    x[0].s_voidp = 0;
+    int i = 0;
+    int mismatch = 0;
+    int unpack[] = { 0, (++i, SmokeStackItem<typename std::decay<Args>::type>::set(
+                                  x[i], storage[i], smoke->typeFlags(smoke->argumentListEntry(meth.args + i - 1)), args)
+                              || mismatch || (mismatch = i))... };
+    (void) unpack;
+    if (mismatch)
+        callMismatch(method, mismatch);
+
+    const unsigned short retFlags = meth.ret ? smoke->typeFlags(meth.ret) : 0;
+    if (!SmokeReturnValue<R>::fits(retFlags))
+        callMismatch(method, 0);
+
+    SmokeReturnValue<R> result(smoke, x[0], retFlags);
+    ClassFn fn = smoke->thunk(method.index);
+    if (!fn)
+        fn = smoke->classEntry(meth.classId).classFn;
+    (*fn)(meth.method, obj, x);
+    return result.take(x[0], retFlags);
+}
+
 class SmokeBinding {
 protected:
     Smoke *smoke;
@@ -46,6 +46,9 @@ loadSmokeModule(QString moduleName) {
 
     if (!init)
         qFatal("Couldn't resolve %s: %s", qPrintable(init_name), qPrintable(lib.errorString()));
+
+    if (!Smoke::isSupportedIndexSize((const int*) lib.resolve(QString(moduleName + "_Smoke_indexSize").toLatin1())))
+        qFatal("%s has tables with an index size smokebase doesn't support", qPrintable(moduleName));
     
     (*init)();
 
@@ -62,7 +65,7 @@ methodToString(Smoke::ModuleIndex methodId)
 {
     QString result;
     Smoke * smoke = methodId.smoke;
-    Smoke::Method& methodRef = smoke->methods[methodId.index];
+    const Smoke::WideMethod methodRef = smoke->methodEntry(methodId.index);
     
     if ((methodRef.flags & Smoke::mf_signal) != 0) {
         result.append("signal ");
@@ -72,12 +75,12 @@ methodToString(Smoke::ModuleIndex methodId)
         result.append("slot ");
     }
     
-    const char * typeName = smoke->types[methodRef.ret].name;
+    const char * typeName = smoke->typeName(methodRef.ret);
     
     if ((methodRef.flags & Smoke::mf_enum) != 0) {
         result.append(QString("enum %1::%2")
-                            .arg(smoke->classes[methodRef.classId].className)
-                            .arg(smoke->methodNames[methodRef.name]) );
+                            .arg(smoke->className(methodRef.classId))
+                            .arg(smoke->methodName(methodRef.name)) );
         return result;
     }
     
@@ -86,7 +89,7 @@ methodToString(Smoke::ModuleIndex methodId)
     }
     
     if (	(methodRef.flags & Smoke::mf_static) != 0
-            && (smoke->classes[methodRef.classId].flags & Smoke::cf_namespace) == 0 )
+            && (smoke->classFlags(methodRef.classId) & Smoke::cf_namespace) == 0 )
     {
         result.append("static ");
     }
@@ -97,15 +100,15 @@ methodToString(Smoke::ModuleIndex methodId)
     }
     
     result.append(  QString("%1::%2(")
-                        .arg(smoke->classes[methodRef.classId].className)
-                        .arg(smoke->methodNames[methodRef.name]) );
+                        .arg(smoke->className(methodRef.classId))
+                        .arg(smoke->methodName(methodRef.name)) );
                         
     for (int i = 0; i < methodRef.numArgs; i++) {
         if (i > 0) {
             result.append(", ");
         }
         
-        typeName = smoke->types[smoke->argumentList[methodRef.args+i]].name;
+        typeName = smoke->typeName(smoke->argumentListEntry(methodRef.args+i));
         result.append((typeName != 0 ? typeName : "void"));
     }
     
@@ -128,11 +131,11 @@ getAllParents(const Smoke::ModuleIndex& classId, int indent)
     Smoke* smoke = classId.smoke;
     QList<ClassEntry> result;
     
-    for (   Smoke::Index * parent = smoke->inheritanceList + smoke->classes[classId.index].parents; 
-            *parent != 0; 
+    for (   Smoke::Index parent = smoke->classParents(classId.index); 
+            smoke->inheritanceListEntry(parent) != 0; 
             parent++ ) 
     {
-        Smoke::ModuleIndex parentId = Smoke::findClass(smoke->classes[*parent].className);
+        Smoke::ModuleIndex parentId = Smoke::findClass(smoke->className(smoke->inheritanceListEntry(parent)));
         Q_ASSERT(parentId != Smoke::NullModuleIndex);
         result << getAllParents(parentId, indent + 1);
     }
@@ -145,7 +148,7 @@ static void
 showClass(const Smoke::ModuleIndex& classId, int indent)
 {
     if (showClassNamesOnly) {
-        QString className = QString::fromLatin1(classId.smoke->classes[classId.index].className);    
+        QString className = QString::fromLatin1(classId.smoke->className(classId.index));    
         if (!matchPattern || targetPattern.indexIn(className) != -1) {
 			while (indent > 0) {
 				qOut << "  ";
@@ -158,55 +161,25 @@ showClass(const Smoke::ModuleIndex& classId, int indent)
     }
     
     Smoke * smoke = classId.smoke;
-    Smoke::Index imax = smoke->numMethodMaps;
-    Smoke::Index imin = 0, icur = -1, methmin, methmax;
-    methmin = -1; methmax = -1; // kill warnings
-    int icmp = -1;
+    Smoke::Index methmin, methend;
+    smoke->methodMapRange(classId.index, &methmin, &methend);
 
-    while (imax >= imin) {
-        icur = (imin + imax) / 2;
-        icmp = smoke->leg(smoke->methodMaps[icur].classId, classId.index);
-        if (icmp == 0) {
-            Smoke::Index pos = icur;
-            while (icur != 0 && smoke->methodMaps[icur-1].classId == classId.index) {
-                icur --;
-            }
-            
-            methmin = icur;
-            icur = pos;
-            while (icur < imax && smoke->methodMaps[icur+1].classId == classId.index) {
-                icur ++;
+    for (Smoke::Index i = methmin ; i < methend ; i++) {
+        Smoke::Index ix = smoke->methodMapEntry(i).method;
+        if (ix >= 0) {  // single match
+            QString method = methodToString(Smoke::ModuleIndex(smoke, ix));
+            if (!matchPattern || targetPattern.indexIn(method) != -1) {
+                qOut << method << "\n";
             }
-            
-            methmax = icur;
-            break;
-        }
-        
-        if (icmp > 0) {
-            imax = icur - 1;
-        } else {
-            imin = icur + 1;
-        }
-    }
-
-    if (icmp == 0) {
-        for (Smoke::Index i = methmin ; i <= methmax ; i++) {
-            Smoke::Index ix = smoke->methodMaps[i].method;
-            if (ix >= 0) {  // single match
-                QString method = methodToString(Smoke::ModuleIndex(smoke, ix));
+        } else {        // multiple match
+            ix = -ix;       // turn into ambiguousMethodList index
+            while (smoke->ambiguousMethodListEntry(ix)) {
+                QString method = methodToString(Smoke::ModuleIndex(smoke, smoke->ambiguousMethodListEntry(ix)));
                 if (!matchPattern || targetPattern.indexIn(method) != -1) {
                     qOut << method << "\n";
                 }
-            } else {        // multiple match
-                ix = -ix;       // turn into ambiguousMethodList index
-                while (smoke->ambiguousMethodList[ix]) {
-                    QString method = methodToString(Smoke::ModuleIndex(smoke, smoke->ambiguousMethodList[ix]));
-                    if (!matchPattern || targetPattern.indexIn(method) != -1) {
-                        qOut << method << "\n";
-                    }
-                    
-                    ix++;
-                }
+                
+                ix++;
             }
         }
     }
@@ -275,7 +248,7 @@ int main(int argc, char** argv)
         } else {
             for (Smoke * smoke : smokeModules) {
                 for (int i = 1; i <= smoke->numClasses; i++) {
-                    if (!smoke->classes[i].external) {
+                    if (!smoke->isExternalClass(i)) {
                         showClass(Smoke::ModuleIndex(smoke, i), 0);
                     }
                 }
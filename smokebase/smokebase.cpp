@@ -2,5 +2,631 @@
 
 #include <smoke.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <vector>
+
 Smoke::ClassMap Smoke::classMap;
 Smoke::ModuleIndex Smoke::NullModuleIndex;
+
+// Lookup state of a module, filled on demand. Readers never lock: the per class tables are published with a
+// compare-and-swap, the method cache entries are guarded by a sequence number each.
+//
+// Everything that refers to other modules is tagged with the generation of the cache it was built in. Deleting a
+// module bumps the generation of all others, so nothing found in it is used again, even if another module is later
+// loaded at the same address. Tables that miss the classes of a module that isn't loaded yet are also tagged with the
+// registry generation, which every newly registered module bumps. Replaced tables may still be read by other
+// threads, they're freed with the cache.
+struct Smoke::LookupCache {
+    struct MethodEntry {
+        std::atomic<unsigned int> sequence;     // odd while the entry is written
+        std::atomic<unsigned int> generation;
+        std::atomic<unsigned int> nameHash;
+        std::atomic<Index> classId;
+        std::atomic<Smoke *> smoke;
+        std::atomic<Index> methodMap;
+    };
+    static const unsigned int NumMethodEntries = 1024;
+
+    static const int MaxCachedArguments = 6;    // calls with more arguments are resolved every time
+
+    // A hit is checked against the full argument types, the signature only selects the entry
+    struct OverloadEntry {
+        std::atomic<unsigned int> sequence;     // odd while the entry is written
+        std::atomic<unsigned int> generation;
+        std::atomic<Index> methodMap;
+        std::atomic<unsigned long long> signature;
+        std::atomic<int> numArgs;
+        std::atomic<unsigned long long> argumentKeys[MaxCachedArguments];
+        std::atomic<Smoke *> argumentModules[MaxCachedArguments];
+        std::atomic<Index> method;
+    };
+    static const unsigned int NumOverloadEntries = 1024;
+
+    // The class followed by its base classes, depth first, terminated by a null ModuleIndex
+    struct ClassOrder {
+        unsigned int generation;
+        unsigned int registryGeneration;    // only checked if the order isn't complete
+        bool complete;
+        std::vector<ModuleIndex> classes;
+    };
+
+    // The class and all of its base classes
+    struct Ancestors {
+        unsigned int generation;
+        unsigned int registryGeneration;    // only checked if the table isn't complete
+        bool complete;
+        std::vector<unsigned long> local;       // Bitset of class IDs of this module, including external classes
+        std::vector<ModuleIndex> foreign;       // Classes of other modules, sorted
+    };
+
+    // The IDs of the classes of another module in this module, indexed by their ID there. 0 if not looked up yet,
+    // -1 if this module doesn't have the class.
+    struct ClassTranslation {
+        std::atomic<Smoke *> foreign;   // 0 after the other module was deleted
+        std::atomic<Index> *ids;
+        ClassTranslation *next;
+    };
+
+    LookupCache(Index _numClasses) : numClasses(_numClasses), generation(0), methodEntries(nullptr), classOrders(nullptr),
+                                     classAncestors(nullptr), classTranslations(nullptr), overloadEntries(nullptr) {}
+    ~LookupCache();
+
+    // *complete is set to false if a module with base classes isn't loaded yet
+    const Ancestors *ancestors(Smoke *smoke, Index classId, bool *complete);
+    bool buildAncestors(Smoke *smoke, Index classId, Ancestors *built);
+
+    // isDerivedFrom() and the argument scores of resolveMethod(); *complete is set to false if a module with base
+    // classes isn't loaded yet, so the answer may change later
+    static bool isDerivedFrom(Smoke *smoke, Index classId, Smoke *baseSmoke, Index baseId, bool *complete);
+    static int argumentScore(Smoke *smoke, const WideType &param, const ArgumentType &arg, bool *complete);
+
+    // Puts 'built' in place of 'stale' and returns the table to use
+    template<typename T>
+    const T *publish(std::atomic<const T *> &slot, const T *stale, const T *built, std::vector<const T *> &retired) {
+        const T *expected = stale;
+        if (!slot.compare_exchange_strong(expected, built, std::memory_order_acq_rel)) {
+            delete built;
+            return expected;
+        }
+        if (stale) {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            retired.push_back(stale);
+        }
+        return built;
+    }
+
+    Index numClasses;
+    std::atomic<unsigned int> generation;
+    std::atomic<MethodEntry *> methodEntries;
+    std::atomic<std::atomic<const ClassOrder *> *> classOrders;
+    std::atomic<std::atomic<const Ancestors *> *> classAncestors;
+    std::atomic<ClassTranslation *> classTranslations;
+    std::atomic<OverloadEntry *> overloadEntries;
+
+    std::mutex retiredMutex;
+    std::vector<const ClassOrder *> retiredOrders;
+    std::vector<const Ancestors *> retiredAncestors;
+};
+
+Smoke::LookupCache::~LookupCache() {
+    delete[] methodEntries.load();
+    delete[] overloadEntries.load();
+    std::atomic<const ClassOrder *> *orders = classOrders.load();
+    if (orders) {
+        for (Index i = 0; i <= numClasses; ++i)
+            delete orders[i].load();
+        delete[] orders;
+    }
+    std::atomic<const Ancestors *> *ancestors = classAncestors.load();
+    if (ancestors) {
+        for (Index i = 0; i <= numClasses; ++i)
+            delete ancestors[i].load();
+        delete[] ancestors;
+    }
+    for (std::size_t i = 0; i < retiredOrders.size(); ++i)
+        delete retiredOrders[i];
+    for (std::size_t i = 0; i < retiredAncestors.size(); ++i)
+        delete retiredAncestors[i];
+    ClassTranslation *translation = classTranslations.load();
+    while (translation) {
+        ClassTranslation *next = translation->next;
+        delete[] translation->ids;
+        delete translation;
+        translation = next;
+    }
+}
+
+namespace {
+
+// The loaded modules, most recently loaded first. Nodes are never freed, so findClass() can walk the list without
+// locking. Deleting a module clears the pointer in its node, and the next module registered takes that node.
+struct ModuleNode {
+    std::atomic<Smoke *> smoke;
+    ModuleNode *next;
+};
+
+std::atomic<ModuleNode *> moduleList(nullptr);
+std::mutex registryMutex;   // serializes the writers
+std::atomic<unsigned int> registryGeneration(0);    // bumped by every registered module
+
+// whether a table built in 'generation' of a module's cache can still be used
+template<typename T>
+bool isCurrent(const T *table, unsigned int generation) {
+    return table && table->generation == generation
+           && (table->complete || table->registryGeneration == registryGeneration.load(std::memory_order_acquire));
+}
+
+template<typename T>
+T *lazyArray(std::atomic<T *> &array, std::size_t size) {
+    T *a = array.load(std::memory_order_acquire);
+    if (a)
+        return a;
+    T *created = new T[size]();
+    if (array.compare_exchange_strong(a, created, std::memory_order_acq_rel))
+        return created;
+    delete[] created;
+    return a;
+}
+
+// appends the class and its base classes, depth first; returns false if a base class isn't loaded
+bool appendClassOrder(Smoke *smoke, Smoke::Index classId, std::vector<Smoke::ModuleIndex> &order) {
+    Smoke::ModuleIndex mi(smoke, classId);
+    if (std::find(order.begin(), order.end(), mi) == order.end())
+        order.push_back(mi);
+
+    bool complete = true;
+    for (Smoke::Index p = smoke->classParents(classId); smoke->inheritanceListEntry(p); ++p) {
+        Smoke::Index parentId = smoke->inheritanceListEntry(p);
+        Smoke::ModuleIndex parent(smoke, parentId);
+        if (smoke->isExternalClass(parentId)) {
+            parent = Smoke::findClass(smoke->className(parentId));
+            if (!parent.smoke) {
+                complete = false;
+                continue;
+            }
+        }
+        if (!appendClassOrder(parent.smoke, parent.index, order))
+            complete = false;
+    }
+    return complete;
+}
+
+const unsigned int BitsPerWord = sizeof(unsigned long) * 8;
+
+bool moduleIndexLess(const Smoke::ModuleIndex &a, const Smoke::ModuleIndex &b) {
+    if (a.smoke != b.smoke)
+        return std::less<Smoke *>()(a.smoke, b.smoke);
+    return a.index < b.index;
+}
+
+// 64 bit FNV-1a over the argument types
+unsigned long long argumentSignature(const Smoke::ArgumentType *args, int numArgs) {
+    unsigned long long h = 14695981039346656037ull;
+    const unsigned long long prime = 1099511628211ull;
+    h = (h ^ (unsigned int) numArgs) * prime;
+    for (int i = 0; i < numArgs; ++i) {
+        h = (h ^ (unsigned int) args[i].typeId) * prime;
+        h = (h ^ args[i].flags) * prime;
+        if (args[i].typeId == Smoke::t_class) {
+            h = (h ^ (unsigned long long) (std::size_t) args[i].classId.smoke) * prime;
+            h = (h ^ (unsigned int) args[i].classId.index) * prime;
+        }
+    }
+    return h;
+}
+
+// an argument type without its module, which is compared on its own
+unsigned long long argumentKey(const Smoke::ArgumentType &arg) {
+    unsigned long long key = (unsigned long long) (unsigned int) arg.typeId | (unsigned long long) arg.flags << 16;
+    if (arg.typeId == Smoke::t_class)
+        key |= (unsigned long long) (unsigned int) arg.classId.index << 32;
+    return key;
+}
+
+bool isNumeric(unsigned int typeId) {
+    return typeId >= Smoke::t_char && typeId <= Smoke::t_double;
+}
+
+Smoke::ModuleIndex findInClassOrder(const Smoke::ModuleIndex *order, Smoke *nameSmoke, Smoke::Index name, const char *methodName) {
+    for (; order->smoke; ++order) {
+        Smoke::Index n = (order->smoke == nameSmoke) ? name : order->smoke->idMethodName(methodName).index;
+        if (!n)
+            continue;
+        Smoke::ModuleIndex mi = order->smoke->idMethod(order->index, n);
+        if (mi.index)
+            return mi;
+    }
+    return Smoke::NullModuleIndex;
+}
+
+}
+
+bool Smoke::isSupportedIndexSize(const int *indexSize) {
+    // modules without the symbol predate 32 bit indexes and use short indexes
+    if (!indexSize)
+        return true;
+    return *indexSize == sizeof(short) || *indexSize == sizeof(int);
+}
+
+void Smoke::registerModule(Smoke *smoke) {
+    smoke->lookupCache = new LookupCache(smoke->numClasses);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ModuleNode *node = moduleList.load(std::memory_order_relaxed);
+    while (node && node->smoke.load(std::memory_order_relaxed))
+        node = node->next;
+    if (node) {
+        node->smoke.store(smoke, std::memory_order_release);
+    } else {
+        node = new ModuleNode;
+        node->smoke.store(smoke, std::memory_order_relaxed);
+        node->next = moduleList.load(std::memory_order_relaxed);
+        moduleList.store(node, std::memory_order_release);
+    }
+    // tables that were missing classes of this module are built again
+    registryGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void Smoke::unregisterModule(Smoke *smoke) {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (ModuleNode *node = moduleList.load(std::memory_order_relaxed); node; node = node->next) {
+            Smoke *other = node->smoke.load(std::memory_order_relaxed);
+            if (other == smoke) {
+                node->smoke.store(0, std::memory_order_release);
+            } else if (other) {
+                // a module loaded later at the same address mustn't use the IDs of this one, nor anything found in it
+                other->lookupCache->generation.fetch_add(1, std::memory_order_acq_rel);
+                LookupCache::ClassTranslation *translation = other->lookupCache->classTranslations.load(std::memory_order_acquire);
+                for (; translation; translation = translation->next) {
+                    if (translation->foreign.load(std::memory_order_relaxed) == smoke)
+                        translation->foreign.store(0, std::memory_order_release);
+                }
+            }
+        }
+    }
+    delete smoke->lookupCache;
+    smoke->lookupCache = 0;
+}
+
+Smoke::~Smoke() {
+    unregisterModule(this);
+}
+
+Smoke::ModuleIndex Smoke::findClass(const char *c) {
+    for (ModuleNode *node = moduleList.load(std::memory_order_acquire); node; node = node->next) {
+        Smoke *smoke = node->smoke.load(std::memory_order_acquire);
+        if (!smoke)
+            continue;
+        ModuleIndex mi = smoke->idClass(c);
+        if (mi.index)
+            return mi;
+    }
+
+    ClassMap::iterator i = classMap.find(c);
+    if (i == classMap.end()) {
+        return NullModuleIndex;
+    } else {
+        return i->second;
+    }
+}
+
+std::vector<Smoke *> Smoke::loadedModules() {
+    std::vector<Smoke *> modules;
+    for (ModuleNode *node = moduleList.load(std::memory_order_acquire); node; node = node->next) {
+        if (Smoke *smoke = node->smoke.load(std::memory_order_acquire))
+            modules.push_back(smoke);
+    }
+    return modules;
+}
+
+Smoke::Index Smoke::idClass(const ModuleIndex &foreignClass) {
+    if (foreignClass.smoke == this)
+        return foreignClass.index;
+
+    LookupCache::ClassTranslation *translation = lookupCache->classTranslations.load(std::memory_order_acquire);
+    LookupCache::ClassTranslation *first = translation;
+    for (; translation; translation = translation->next) {
+        if (translation->foreign.load(std::memory_order_acquire) == foreignClass.smoke)
+            break;
+    }
+    if (!translation) {
+        translation = new LookupCache::ClassTranslation;
+        translation->foreign.store(foreignClass.smoke, std::memory_order_relaxed);
+        translation->ids = new std::atomic<Index>[foreignClass.smoke->numClasses + 1]();
+        translation->next = first;
+        // if another table was added in the meantime, this one is still used for this call, but thrown away
+        if (!lookupCache->classTranslations.compare_exchange_strong(first, translation, std::memory_order_acq_rel)) {
+            Index id = idClass(foreignClass.smoke->className(foreignClass.index), true).index;
+            delete[] translation->ids;
+            delete translation;
+            return id;
+        }
+    }
+
+    std::atomic<Index> &id = translation->ids[foreignClass.index];
+    Index i = id.load(std::memory_order_relaxed);
+    if (!i) {
+        // threads that get here at the same time store the same value
+        i = idClass(foreignClass.smoke->className(foreignClass.index), true).index;
+        id.store(i ? i : -1, std::memory_order_relaxed);
+    }
+    return i > 0 ? i : 0;
+}
+
+Smoke::ModuleIndex Smoke::findMethod(ModuleIndex c, ModuleIndex name) {
+    if (!c.index || !name.index) {
+        return NullModuleIndex;
+    } else if (c.smoke != this) {
+        return c.smoke->findMethod(c, name);
+    }
+
+    const char *methodName = name.smoke->methodName(name.index);
+    const unsigned int nameHash = hashName(methodName, 0);
+    const unsigned int generation = lookupCache->generation.load(std::memory_order_acquire);
+    LookupCache::MethodEntry *entries = lazyArray(lookupCache->methodEntries, LookupCache::NumMethodEntries);
+    LookupCache::MethodEntry &entry = entries[(nameHash ^ (unsigned int) c.index * 2654435761u) % LookupCache::NumMethodEntries];
+
+    unsigned int sequence = entry.sequence.load(std::memory_order_acquire);
+    if (!(sequence & 1)) {
+        unsigned int entryGeneration = entry.generation.load(std::memory_order_relaxed);
+        unsigned int entryHash = entry.nameHash.load(std::memory_order_relaxed);
+        Index entryClass = entry.classId.load(std::memory_order_relaxed);
+        Smoke *entrySmoke = entry.smoke.load(std::memory_order_relaxed);
+        Index entryMethodMap = entry.methodMap.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) == sequence && entrySmoke && entryGeneration == generation
+            && entryHash == nameHash && entryClass == c.index
+            && strcmp(entrySmoke->methodName(entrySmoke->methodMapEntry(entryMethodMap).name), methodName) == 0)
+        {
+            return ModuleIndex(entrySmoke, entryMethodMap);
+        }
+    }
+
+    ModuleIndex mi;
+    bool complete = true;
+    std::atomic<const LookupCache::ClassOrder *> *orders = lazyArray(lookupCache->classOrders, numClasses + 1);
+    const LookupCache::ClassOrder *order = orders[c.index].load(std::memory_order_acquire);
+    if (!isCurrent(order, generation)) {
+        LookupCache::ClassOrder *newOrder = new LookupCache::ClassOrder;
+        newOrder->generation = generation;
+        newOrder->registryGeneration = registryGeneration.load(std::memory_order_acquire);
+        newOrder->complete = appendClassOrder(this, c.index, newOrder->classes);
+        newOrder->classes.push_back(NullModuleIndex);
+        order = lookupCache->publish(orders[c.index], order, (const LookupCache::ClassOrder *) newOrder, lookupCache->retiredOrders);
+    }
+    mi = findInClassOrder(order->classes.data(), name.smoke, name.index, methodName);
+    complete = order->complete;
+
+    // misses and hits that a module loaded later could hide aren't cached; an entry that is being written by
+    // another thread is left alone
+    if (mi.index && complete && !(sequence & 1)
+        && entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
+    {
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.generation.store(generation, std::memory_order_relaxed);
+        entry.nameHash.store(nameHash, std::memory_order_relaxed);
+        entry.classId.store(c.index, std::memory_order_relaxed);
+        entry.smoke.store(mi.smoke, std::memory_order_relaxed);
+        entry.methodMap.store(mi.index, std::memory_order_relaxed);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    return mi;
+}
+
+// Returns the base classes of a class. External classes are resolved with findClass() when the table is built. If
+// one isn't loaded yet, the table is built again once another module is registered.
+const Smoke::LookupCache::Ancestors *Smoke::LookupCache::ancestors(Smoke *smoke, Index classId, bool *complete) {
+    const unsigned int currentGeneration = generation.load(std::memory_order_acquire);
+    std::atomic<const Ancestors *> *tables = lazyArray(classAncestors, numClasses + 1);
+    const Ancestors *table = tables[classId].load(std::memory_order_acquire);
+    if (!isCurrent(table, currentGeneration)) {
+        Ancestors *built = new Ancestors;
+        built->generation = currentGeneration;
+        built->registryGeneration = registryGeneration.load(std::memory_order_acquire);
+        built->complete = buildAncestors(smoke, classId, built);
+        table = publish(tables[classId], table, (const Ancestors *) built, retiredAncestors);
+    }
+    if (!table->complete)
+        *complete = false;
+    return table;
+}
+
+bool Smoke::LookupCache::buildAncestors(Smoke *smoke, Index classId, Ancestors *built) {
+    built->local.resize(numClasses / BitsPerWord + 1);
+    built->local[classId / BitsPerWord] |= 1ul << (classId % BitsPerWord);
+    bool complete = true;
+
+    if (smoke->isExternalClass(classId)) {
+        ModuleIndex resolved = findClass(smoke->className(classId));
+        if (resolved.smoke && resolved.smoke != smoke) {
+            const Ancestors *other = resolved.smoke->lookupCache->ancestors(resolved.smoke, resolved.index, &complete);
+            for (unsigned int i = 0; i < other->local.size() * BitsPerWord; ++i) {
+                if (other->local[i / BitsPerWord] & (1ul << (i % BitsPerWord)))
+                    built->foreign.push_back(ModuleIndex(resolved.smoke, i));
+            }
+            built->foreign.insert(built->foreign.end(), other->foreign.begin(), other->foreign.end());
+        } else {
+            complete = false;
+        }
+    }
+
+    for (Index p = smoke->classParents(classId); smoke->inheritanceListEntry(p); ++p) {
+        const Ancestors *parent = ancestors(smoke, smoke->inheritanceListEntry(p), &complete);
+        for (std::size_t i = 0; i < built->local.size(); ++i)
+            built->local[i] |= parent->local[i];
+        built->foreign.insert(built->foreign.end(), parent->foreign.begin(), parent->foreign.end());
+    }
+
+    std::sort(built->foreign.begin(), built->foreign.end(), moduleIndexLess);
+    built->foreign.erase(std::unique(built->foreign.begin(), built->foreign.end()), built->foreign.end());
+    return complete;
+}
+
+bool Smoke::isDerivedFrom(Smoke *smoke, Index classId, Smoke *baseSmoke, Index baseId) {
+    bool complete;
+    return LookupCache::isDerivedFrom(smoke, classId, baseSmoke, baseId, &complete);
+}
+
+bool Smoke::LookupCache::isDerivedFrom(Smoke *smoke, Index classId, Smoke *baseSmoke, Index baseId, bool *complete) {
+    if (!classId || !baseId || !smoke || !baseSmoke)
+        return false;
+    if (smoke == baseSmoke && classId == baseId)
+        return true;
+
+    const Ancestors *table = smoke->lookupCache->ancestors(smoke, classId, complete);
+    bool derived;
+    if (smoke == baseSmoke) {
+        derived = baseId > 0 && baseId <= smoke->numClasses
+                  && (table->local[baseId / BitsPerWord] & (1ul << (baseId % BitsPerWord)));
+    } else {
+        derived = std::binary_search(table->foreign.begin(), table->foreign.end(), ModuleIndex(baseSmoke, baseId), moduleIndexLess);
+    }
+    return derived;
+}
+
+// How well an argument fits a parameter type: 3 exact, 2 conversion or base class, 1 weak conversion, 0 not at all
+int Smoke::LookupCache::argumentScore(Smoke *smoke, const WideType &param, const ArgumentType &arg, bool *complete) {
+    const unsigned int paramId = param.flags & Smoke::tf_elem;
+    const bool indirect = (param.flags & Smoke::tf_ref) == Smoke::tf_ptr || (param.flags & Smoke::tf_ref) == Smoke::tf_ref;
+
+    switch (arg.typeId) {
+    case Smoke::t_class: {
+        if (paramId == Smoke::t_voidp)
+            return 1;
+        if (paramId != Smoke::t_class || param.classId <= 0 || !arg.classId.smoke)
+            return 0;
+        ModuleIndex paramClass(smoke, param.classId);
+        if (smoke->isExternalClass(param.classId)) {
+            paramClass = findClass(smoke->className(param.classId));
+            if (!paramClass.smoke)
+                *complete = false;
+        }
+        int score;
+        if (paramClass == arg.classId)
+            score = 3;
+        else if (isDerivedFrom(arg.classId.smoke, arg.classId.index, paramClass.smoke, paramClass.index, complete))
+            score = 2;
+        else
+            return 0;
+        // a const object can still be copied, but it's a worse fit for a non-const reference or pointer
+        if ((arg.flags & Smoke::tf_const) && indirect && !(param.flags & Smoke::tf_const))
+            score = 1;
+        return score;
+    }
+    case Smoke::t_voidp:
+        if (paramId == Smoke::t_voidp)
+            return 3;
+        return (param.flags & Smoke::tf_ref) == Smoke::tf_ptr ? 1 : 0;
+    case Smoke::t_enum:
+        if (paramId == Smoke::t_enum)
+            return 2;
+        return isNumeric(paramId) ? 1 : 0;
+    default:
+        if (paramId == (unsigned int) arg.typeId)
+            return 3;
+        if (isNumeric(paramId) && isNumeric(arg.typeId))
+            return 2;
+        if ((paramId == Smoke::t_bool && isNumeric(arg.typeId)) || (arg.typeId == Smoke::t_bool && isNumeric(paramId))
+            || (paramId == Smoke::t_enum && isNumeric(arg.typeId)))
+            return 1;
+        return 0;
+    }
+}
+
+Smoke::Index Smoke::resolveMethod(Index methodMap, const ArgumentType *args, int numArgs) {
+    if (methodMap <= 0 || methodMap >= numMethodMaps)
+        return 0;
+
+    const unsigned long long signature = argumentSignature(args, numArgs);
+    const unsigned int generation = lookupCache->generation.load(std::memory_order_acquire);
+    LookupCache::OverloadEntry *entries = lazyArray(lookupCache->overloadEntries, LookupCache::NumOverloadEntries);
+    LookupCache::OverloadEntry &entry = entries[(signature ^ (unsigned int) methodMap * 2654435761u) % LookupCache::NumOverloadEntries];
+
+    const bool cacheable = numArgs >= 0 && numArgs <= LookupCache::MaxCachedArguments;
+    unsigned int sequence = entry.sequence.load(std::memory_order_acquire);
+    if (cacheable && sequence && !(sequence & 1)) {
+        unsigned int entryGeneration = entry.generation.load(std::memory_order_relaxed);
+        Index entryMethodMap = entry.methodMap.load(std::memory_order_relaxed);
+        unsigned long long entrySignature = entry.signature.load(std::memory_order_relaxed);
+        int entryNumArgs = entry.numArgs.load(std::memory_order_relaxed);
+        bool match = entryGeneration == generation && entryMethodMap == methodMap && entrySignature == signature
+                     && entryNumArgs == numArgs;
+        for (int i = 0; i < numArgs && match; ++i) {
+            match = entry.argumentKeys[i].load(std::memory_order_relaxed) == argumentKey(args[i])
+                    && entry.argumentModules[i].load(std::memory_order_relaxed)
+                       == (args[i].typeId == t_class ? args[i].classId.smoke : 0);
+        }
+        Index entryMethod = entry.method.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (match && entry.sequence.load(std::memory_order_relaxed) == sequence)
+            return entryMethod;
+    }
+
+    // a single method or a 0 terminated list of candidates in ambiguousMethodList
+    Index single = methodMapEntry(methodMap).method;
+    Index next = -single;
+
+    Index best = 0;
+    int bestScore = 0;
+    bool complete = true;
+    for (Index c = (single > 0) ? single : ambiguousMethodListEntry(next); c;
+         c = (single > 0) ? 0 : ambiguousMethodListEntry(++next))
+    {
+        const WideMethod meth = methodEntry(c);
+        if (meth.numArgs != numArgs)
+            continue;
+        int score = 0;
+        for (int i = 0; i < numArgs; ++i) {
+            int s = LookupCache::argumentScore(this, typeEntry(argumentListEntry(meth.args + i)), args[i], &complete);
+            if (!s) {
+                score = 0;
+                break;
+            }
+            score += s;
+        }
+        if ((score || !numArgs) && (!best || score > bestScore)) {
+            best = c;
+            bestScore = score;
+        }
+    }
+
+    // decisions that depend on modules that aren't loaded yet are made again next time
+    if (cacheable && complete && !(sequence & 1)
+        && entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
+    {
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.generation.store(generation, std::memory_order_relaxed);
+        entry.methodMap.store(methodMap, std::memory_order_relaxed);
+        entry.signature.store(signature, std::memory_order_relaxed);
+        entry.numArgs.store(numArgs, std::memory_order_relaxed);
+        for (int i = 0; i < numArgs; ++i) {
+            entry.argumentKeys[i].store(argumentKey(args[i]), std::memory_order_relaxed);
+            entry.argumentModules[i].store(args[i].typeId == t_class ? args[i].classId.smoke : 0, std::memory_order_relaxed);
+        }
+        entry.method.store(best, std::memory_order_relaxed);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    return best;
+}
+
+void Smoke::callMismatch(const ModuleIndex &method, int argument) {
+    Smoke *smoke = method.smoke;
+    const WideMethod meth = smoke->methodEntry(method.index);
+    if (argument)
+        std::fprintf(stderr, "smokebase: Smoke::call(): argument %d doesn't fit %s::%s(), expected %s\n", argument,
+                     smoke->className(meth.classId), smoke->methodName(meth.name),
+                     smoke->typeName(smoke->argumentListEntry(meth.args + argument - 1)));
+    else
+        std::fprintf(stderr, "smokebase: Smoke::call(): the result type doesn't fit %s::%s(), which returns %s\n",
+                     smoke->className(meth.classId), smoke->methodName(meth.name),
+                     meth.ret ? smoke->typeName(meth.ret) : "void");
+    std::abort();
+}
@@ -0,0 +1,172 @@
+// Loads one module with 16 bit indexes and one with 32 bit indexes into the same process and checks that lookups,
+// overload resolution, inheritance and calls work in both. The wide module has more than 32767 classes and types,
+// so its indexes don't fit into a short.
+
+#include <smoke.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, smoke->moduleName(), #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// method 0 of Base: int foo(int)
+static void classFn(Smoke::Index method, void *, Smoke::Stack x) {
+    if (method == 0)
+        x[0].s_int = x[1].s_int * 2;
+}
+
+static const char *methodNames[] = { "", "bar$", "foo$" };
+
+// Base and Derived : Base, with foo$(int) in Base and bar$(double) in Derived, as smokegen writes them
+namespace narrow {
+
+Smoke::Class classes[] = {
+    { 0, false, 0, 0, 0, 0, 0 },
+    { "Base", false, 0, classFn, 0, Smoke::cf_constructor, 1 },
+    { "Derived", false, 1, classFn, 0, Smoke::cf_constructor, 1 }
+};
+short inheritanceList[] = { 0, 1, 0 };
+Smoke::Type types[] = {
+    { 0, 0, 0 },
+    { "double", 0, Smoke::t_double | Smoke::tf_stack },
+    { "int", 0, Smoke::t_int | Smoke::tf_stack }
+};
+short argumentList[] = { 0, 2, 0, 1, 0 };
+short ambiguousMethodList[] = { 0 };
+Smoke::Method methods[] = {
+    { 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 2, 1, 1, 0, 2, 0 },
+    { 2, 1, 3, 1, 0, 0, 1 }
+};
+// the last entry is only read by the binary search of idMethod()
+Smoke::MethodMap methodMaps[] = { { 0, 0, 0 }, { 1, 2, 1 }, { 2, 1, 2 }, { 0, 0, 0 } };
+
+}
+
+// the same classes, with 39998 classes and types between them
+struct WideModule {
+    static const int NumClasses = 40000;
+    static const int NumTypes = 40000;
+
+    WideModule() {
+        classNames.push_back("");
+        for (int i = 1; i <= NumClasses; ++i) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "C%05d", i);
+            classNames.push_back(name);
+        }
+        typeNames.push_back("");
+        for (int i = 1; i < NumTypes; ++i) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "T%05d", i);
+            typeNames.push_back(name);
+        }
+        typeNames.push_back("int");
+
+        Smoke::WideClass noClass = { 0, false, 0, 0, 0, 0, 0 };
+        classes.push_back(noClass);
+        for (int i = 1; i <= NumClasses; ++i) {
+            Smoke::WideClass klass = { classNames[i].c_str(), false, i == NumClasses ? 1 : 0, classFn, 0, Smoke::cf_constructor, 1 };
+            classes.push_back(klass);
+        }
+        inheritanceList = { 0, 1, 0 };
+
+        Smoke::WideType noType = { 0, 0, 0 };
+        types.push_back(noType);
+        for (int i = 1; i <= NumTypes; ++i) {
+            Smoke::WideType type = { typeNames[i].c_str(), 0,
+                                     (unsigned short) ((i == NumTypes ? Smoke::t_int : Smoke::t_double) | Smoke::tf_stack) };
+            types.push_back(type);
+        }
+        argumentList = { 0, NumTypes, 0, NumTypes - 1, 0 };
+        ambiguousMethodList = { 0 };
+
+        Smoke::WideMethod noMethod = { 0, 0, 0, 0, 0, 0, 0 };
+        Smoke::WideMethod foo = { 1, 2, 1, 1, 0, NumTypes, 0 };
+        Smoke::WideMethod bar = { NumClasses, 1, 3, 1, 0, 0, 1 };
+        methods = { noMethod, foo, bar };
+        Smoke::WideMethodMap noMap = { 0, 0, 0 };
+        Smoke::WideMethodMap fooMap = { 1, 2, 1 };
+        Smoke::WideMethodMap barMap = { NumClasses, 1, 2 };
+        methodMaps = { noMap, fooMap, barMap, noMap };
+
+        Smoke::WideTables tables = { classes.data(), methods.data(), methodMaps.data(), types.data(),
+                                     inheritanceList.data(), argumentList.data(), ambiguousMethodList.data() };
+        wideTables = tables;
+    }
+
+    std::vector<std::string> classNames, typeNames;
+    std::vector<Smoke::WideClass> classes;
+    std::vector<Smoke::WideType> types;
+    std::vector<Smoke::WideMethod> methods;
+    std::vector<Smoke::WideMethodMap> methodMaps;
+    std::vector<int> inheritanceList, argumentList, ambiguousMethodList;
+    Smoke::WideTables wideTables;
+};
+
+static void checkModule(Smoke *smoke, int indexSize, const char *base, const char *derived, Smoke::Index doubleType) {
+    CHECK(smoke->indexSize() == indexSize);
+
+    Smoke::ModuleIndex baseId = smoke->idClass(base);
+    Smoke::ModuleIndex derivedId = smoke->idClass(derived);
+    CHECK(baseId.smoke == smoke && baseId.index == 1);
+    CHECK(derivedId.smoke == smoke && derivedId.index == smoke->numClasses);
+    CHECK(Smoke::isDerivedFrom(derivedId, baseId));
+    CHECK(!Smoke::isDerivedFrom(baseId, derivedId));
+
+    // bar$ is declared in Derived, foo$ is inherited from Base
+    Smoke::ModuleIndex bar = smoke->findMethod(derivedId, smoke->idMethodName("bar$"));
+    Smoke::ModuleIndex foo = smoke->findMethod(derivedId, smoke->idMethodName("foo$"));
+    CHECK(bar.smoke == smoke && bar.index == 2);
+    CHECK(foo.smoke == smoke && foo.index == 1);
+
+    Smoke::ArgumentType doubleArgument = { Smoke::t_double, Smoke::NullModuleIndex, 0 };
+    Smoke::Index method = smoke->resolveMethod(bar.index, &doubleArgument, 1);
+    CHECK(method == 2);
+    CHECK(smoke->methodClassId(method) == smoke->numClasses);
+    CHECK(smoke->argumentListEntry(smoke->methodEntry(method).args) == doubleType);
+    CHECK(smoke->typeFlags(doubleType) == (Smoke::t_double | Smoke::tf_stack));
+
+    CHECK(Smoke::call<int>(Smoke::ModuleIndex(smoke, 1), 0, 21) == 42);
+}
+
+int main() {
+    Smoke *narrowModule = new Smoke("narrow",
+                                    narrow::classes, 2,
+                                    narrow::methods, 3,
+                                    narrow::methodMaps, 3,
+                                    methodNames, 2,
+                                    narrow::types, 2,
+                                    narrow::inheritanceList,
+                                    narrow::argumentList,
+                                    narrow::ambiguousMethodList,
+                                    0);
+    WideModule wide;
+    Smoke *wideModule = new Smoke("wide", &wide.wideTables, WideModule::NumClasses, 3, 3, methodNames, 2, WideModule::NumTypes, 0);
+
+    checkModule(narrowModule, 2, "Base", "Derived", 1);
+    checkModule(wideModule, 4, "C00001", "C40000", WideModule::NumTypes - 1);
+
+    int two = 2, four = 4, eight = 8;
+    Smoke *smoke = wideModule;
+    CHECK(Smoke::isSupportedIndexSize(0));
+    CHECK(Smoke::isSupportedIndexSize(&two));
+    CHECK(Smoke::isSupportedIndexSize(&four));
+    CHECK(!Smoke::isSupportedIndexSize(&eight));
+
+    delete narrowModule;
+    delete wideModule;
+
+    if (failures)
+        std::fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
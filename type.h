@@ -99,10 +99,12 @@ public:
         Class *baseClass;
         Access access;
         bool isVirtual;
+        long long offset;   // of the base class subobject in bytes, -1 for virtual bases or if it's unknown
     };
     
     Class(const QString& name = QString(), const QString nspace = QString(), Class* parent = 0, Kind kind = Kind_Class, bool isForward = true)
-          : BasicTypeDeclaration(name, nspace, parent), m_kind(kind), m_forward(isForward), m_isNamespace(false), m_isTemplate(false) {}
+          : BasicTypeDeclaration(name, nspace, parent), m_kind(kind), m_forward(isForward), m_isNamespace(false), m_isTemplate(false),
+            m_isStandardLayout(false) {}
     virtual ~Class() {}
     
     void setKind(Kind kind) { m_kind = kind; }
@@ -131,11 +133,15 @@ public:
     bool isTemplate() const { return m_isTemplate; }
     void setIsTemplate(bool isTemplate) { m_isTemplate = isTemplate; }
     
+    bool isStandardLayout() const { return m_isStandardLayout; }
+    void setIsStandardLayout(bool isStandardLayout) { m_isStandardLayout = isStandardLayout; }
+    
 private:
     Kind m_kind;
     bool m_forward;
     bool m_isNamespace;
     bool m_isTemplate;
+    bool m_isStandardLayout;
     QList<Method> m_methods;
     QList<Field> m_fields;
     QList<BaseClassSpecifier> m_bases;
@@ -200,6 +206,8 @@ public:
         Static = 0x4,
         DynamicDispatch = 0x8,
         Explicit = 0x10,
+        BitField = 0x20,
+        InClassInitializer = 0x40,  // static member initialized in the class, it may not have a definition
     };
     Q_DECLARE_FLAGS(Flags, Flag)
 